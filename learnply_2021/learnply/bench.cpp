@@ -0,0 +1,383 @@
+/*
+
+Benchmarks of the tracers and samplers
+
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <chrono>
+#include "bench.h"
+#include "policyTracer.h"
+#include "gridField.h"
+#include "cellCache.h"
+
+void random_points(const FieldSampler& field, int n, unsigned seed, std::vector<icVector2>& out)
+{
+	const CellIndex& index = *field.index;
+	out.resize(n);
+	unsigned r = seed;
+	for (int k = 0; k < n; k++) {
+		r = r * 1103515245 + 12345;
+		double u = (r >> 8) / 16777216.0;
+		r = r * 1103515245 + 12345;
+		double v = (r >> 8) / 16777216.0;
+		out[k].set(index.xmin + u * (index.xmax - index.xmin), index.ymin + v * (index.ymax - index.ymin));
+	}
+}
+
+/******************************************************************************
+Time the specialized tracers of policyTracer.h against the generic one on
+the same seeds, and print how far their endpoints are apart
+******************************************************************************/
+
+int run_trace_bench(const std::vector<const char*>& files)
+{
+	const char* integrators[] = { "euler", "rk2", "rk4" };
+	const char* stops[] = { "boundary", "slow", "singularity" };
+	const int nseeds = 2000;
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		FieldContext* ctx = FieldContext::load(files[i]);
+		if (ctx == NULL) {
+			failed++;
+			continue;
+		}
+		const CellIndex& index = *ctx->index;
+		std::vector<Singularity> sings;
+		extract_singularities(*ctx->sampler, sings);
+
+		// the same pseudo-random seeds for every configuration
+		std::vector<icVector2> seeds;
+		random_points(*ctx->sampler, nseeds, 12345, seeds);
+
+		printf("%s: %d seeds, %d singularities\n", ctx->name().c_str(), nseeds, (int)sings.size());
+		printf("%-6s %-6s %-12s %10s %12s %8s %10s\n", "", "", "stop", "generic", "specialized", "speedup", "max diff");
+		std::vector<icVector2> a, b;
+		for (int prec = 0; prec < 2; prec++)
+			for (int integ = 0; integ < 3; integ++)
+				for (int stop = 0; stop < 3; stop++) {
+					TraceConfig config;
+					config.integrator = (TraceIntegrator)integ;
+					config.precision = (TracePrecision)prec;
+					config.stop = (TraceStop)stop;
+					config.h = 0.1 * (index.qx2[0] - index.qx1[0]);
+					config.max_steps = 1000;
+					config.min_speed = 1e-3;
+					config.sings = &sings;
+					config.capture = config.h;
+
+					long long steps_a = 0, steps_b = 0;
+					auto start = std::chrono::steady_clock::now();
+					for (int k = 0; k < nseeds; k++) {
+						a.clear();
+						config.forward = k % 2 == 0;
+						steps_a += trace_streamline_generic(*ctx->sampler, seeds[k], config, a);
+					}
+					double generic_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					start = std::chrono::steady_clock::now();
+					for (int k = 0; k < nseeds; k++) {
+						b.clear();
+						config.forward = k % 2 == 0;
+						steps_b += trace_streamline(*ctx->sampler, seeds[k], config, b);
+					}
+					double special_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+					// endpoints, traced once more outside the timing
+					double max_diff = 0;
+					for (int k = 0; k < nseeds; k++) {
+						a.clear();
+						b.clear();
+						config.forward = k % 2 == 0;
+						trace_streamline_generic(*ctx->sampler, seeds[k], config, a);
+						trace_streamline(*ctx->sampler, seeds[k], config, b);
+						icVector2 end_a = a.empty() ? seeds[k] : a.back(), end_b = b.empty() ? seeds[k] : b.back();
+						double d = length(end_a - end_b);
+						if (d > max_diff)
+							max_diff = d;
+					}
+					printf("%-6s %-6s %-12s %7.1f M/s %9.1f M/s %7.2fx %10.2e\n", prec ? "float" : "double", integrators[integ], stops[stop],
+						steps_a / generic_s * 1e-6, steps_b / special_s * 1e-6, (steps_b / special_s) / (steps_a / generic_s), max_diff);
+				}
+		delete ctx;
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/******************************************************************************
+Trace the same seeds on the double field and on its float copy, with
+double and with float arithmetic, and print how far the endpoints move
+******************************************************************************/
+
+int run_float_report(const std::vector<const char*>& files)
+{
+	const char* integrators[] = { "euler", "rk2", "rk4" };
+	const char* modes[] = { "double", "float field, double math", "float field, float math" };
+	const int nseeds = 2000;
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		FieldContext* ctx = FieldContext::load(files[i]);
+		if (ctx == NULL) {
+			failed++;
+			continue;
+		}
+		const CellIndex& index = *ctx->index;
+		const FieldSampler& sampler = *ctx->sampler;
+		FloatFieldSampler sampler_f(sampler);
+		double cell = index.qx2[0] - index.qx1[0];
+
+		std::vector<icVector2> seeds;
+		random_points(sampler, nseeds, 12345, seeds);
+
+		size_t double_bytes = sampler.f11.size() * 14 * sizeof(double);
+		printf("%s: %d seeds, 200 steps of 0.1 quad, field %.0f KB in double, %.0f KB in float\n", ctx->name().c_str(), nseeds,
+			double_bytes / 1024.0, sampler_f.memory_bytes() / 1024.0);
+		printf("%-6s %-26s %10s %12s %12s %12s\n", "", "", "steps/s", "mean error", "max error", "other length");
+		std::vector<std::vector<icVector2>> reference(nseeds);
+		std::vector<icVector2> points;
+		for (int integ = 0; integ < 3; integ++)
+			for (int mode = 0; mode < 3; mode++) {
+				TraceConfig config;
+				config.integrator = (TraceIntegrator)integ;
+				config.precision = mode == 2 ? TRACE_FLOAT : TRACE_DOUBLE;
+				config.h = 0.1 * cell;
+				config.max_steps = 200;
+
+				long long steps = 0;
+				double sum = 0, worst = 0;
+				int other_length = 0;
+				auto start = std::chrono::steady_clock::now();
+				for (int k = 0; k < nseeds; k++) {
+					config.forward = k % 2 == 0;
+					std::vector<icVector2>& out = mode == 0 ? reference[k] : points;
+					out.clear();
+					steps += mode == 0 ? trace_streamline(sampler, seeds[k], config, out) : trace_streamline(sampler_f, seeds[k], config, out);
+					if (mode == 0)
+						continue;
+					// errors in quads, at the last step both traces reached
+					int n = (int)std::min(out.size(), reference[k].size());
+					if (out.size() != reference[k].size())
+						other_length++;
+					if (n == 0)
+						continue;
+					double d = length(out[n - 1] - reference[k][n - 1]) / cell;
+					sum += d;
+					if (d > worst)
+						worst = d;
+				}
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				printf("%-6s %-26s %8.1f M %12.2e %12.2e %12d\n", integrators[integ], modes[mode], steps / seconds * 1e-6,
+					sum / nseeds, worst, other_length);
+			}
+		delete ctx;
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/******************************************************************************
+Resample each field onto a regular grid, n nodes along its longer side,
+and compare the grid samples with the mesh samples at random points
+******************************************************************************/
+
+int run_resample(const std::vector<const char*>& files, int resolution, int nthreads)
+{
+	const int npoints = 1000000;
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		FieldContext* ctx = FieldContext::load(files[i]);
+		if (ctx == NULL) {
+			failed++;
+			continue;
+		}
+		const CellIndex& index = *ctx->index;
+		const FieldSampler& sampler = *ctx->sampler;
+		double w = index.xmax - index.xmin, h = index.ymax - index.ymin;
+		int nx = w >= h ? resolution : (int)(resolution * w / h + 0.5);
+		int ny = w >= h ? (int)(resolution * h / w + 0.5) : resolution;
+
+		GridField grid;
+		auto start = std::chrono::steady_clock::now();
+		grid.build(sampler, nx, ny, nthreads);
+		double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<icVector2> points;
+		random_points(sampler, npoints, 12345, points);
+
+		// random points, then the same number in scanline order as an image
+		// or a coherent trace reads them; every loop sums its samples so it
+		// can't be dropped
+		icVector2 v, sum;
+		double mesh_s[2], grid_s[2];
+		for (int pass = 0; pass < 2; pass++) {
+			const int m = 1000;
+			start = std::chrono::steady_clock::now();
+			for (int k = 0; k < npoints; k++) {
+				double x = pass == 0 ? points[k].x : index.xmin + w * (k % m + 0.5) / m;
+				double y = pass == 0 ? points[k].y : index.ymin + h * (k / m + 0.5) / (npoints / m);
+				if (sampler.sample(x, y, v))
+					sum += v;
+			}
+			mesh_s[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+			for (int k = 0; k < npoints; k++) {
+				double x = pass == 0 ? points[k].x : index.xmin + w * (k % m + 0.5) / m;
+				double y = pass == 0 ? points[k].y : index.ymin + h * (k / m + 0.5) / (npoints / m);
+				if (grid.sample(x, y, v))
+					sum += v;
+			}
+			grid_s[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// errors relative to the mean magnitude on the mesh
+		int on_mesh = 0, on_grid = 0;
+		double mean_speed = 0, sq_err = 0, max_err = 0;
+		for (int k = 0; k < npoints; k++) {
+			icVector2 vm, vg;
+			if (!sampler.sample(points[k].x, points[k].y, vm))
+				continue;
+			on_mesh++;
+			mean_speed += length(vm);
+			if (!grid.sample(points[k].x, points[k].y, vg))
+				continue;
+			on_grid++;
+			double e = length(vg - vm);
+			sq_err += e * e;
+			if (e > max_err)
+				max_err = e;
+		}
+		mean_speed = on_mesh > 0 ? mean_speed / on_mesh : 1;
+		if (mean_speed == 0)
+			mean_speed = 1;
+		printf("%s: %d quads, grid %d x %d, %.1f ms, %.1f MB (checksum %g)\n", ctx->name().c_str(), (int)sampler.f11.size(), nx, ny,
+			build_ms, grid.memory_bytes() / 1048576.0, sum.x + sum.y);
+		printf("  error rms %.2e max %.2e of the mean magnitude, %.2f%% of the mesh lost at the boundary\n",
+			on_grid > 0 ? sqrt(sq_err / on_grid) / mean_speed : 0.0, max_err / mean_speed,
+			on_mesh > 0 ? 100.0 * (on_mesh - on_grid) / on_mesh : 0.0);
+		for (int pass = 0; pass < 2; pass++)
+			printf("  %s samples: mesh %.1f M/s, grid %.1f M/s, %.1fx\n", pass == 0 ? "random" : "scanline",
+				npoints / mesh_s[pass] * 1e-6, npoints / grid_s[pass] * 1e-6, mesh_s[pass] / grid_s[pass]);
+		delete ctx;
+	}
+	return failed == 0 ? 0 : 1;
+}
+
+/******************************************************************************
+Build the per-quad derivative cache of each field, check that its readers
+give the results they give without it, and time both
+******************************************************************************/
+
+// distance from p to the polyline pts
+static double polyline_distance(const icVector2& p, const std::vector<icVector2>& pts)
+{
+	double best = length(p - pts[0]);
+	for (int i = 0; i + 1 < pts.size(); i++) {
+		icVector2 d = pts[i + 1] - pts[i];
+		double len2 = dot(d, d);
+		double u = len2 > 0 ? dot(p - pts[i], d) / len2 : 0;
+		u = u < 0 ? 0 : (u > 1 ? 1 : u);
+		double dist = length(p - (pts[i] + u * d));
+		if (dist < best)
+			best = dist;
+	}
+	return best;
+}
+
+int run_cell_cache(const std::vector<const char*>& files, const PlacementParams& base)
+{
+	const int nseeds = 2000;
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		FieldContext* ctx = FieldContext::load(files[i]);
+		if (ctx == NULL) {
+			failed++;
+			continue;
+		}
+		const FieldSampler& sampler = *ctx->sampler;
+
+		auto start = std::chrono::steady_clock::now();
+		CellCache cache(&sampler);
+		double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("%s: cache of %d quads in %.1f ms, %.1f MB\n", ctx->name().c_str(), (int)sampler.f11.size(), build_ms,
+			cache.memory_bytes() / 1048576.0);
+
+		// singularity search
+		std::vector<Singularity> plain, cached;
+		start = std::chrono::steady_clock::now();
+		extract_singularities(sampler, plain);
+		double plain_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+		extract_singularities(sampler, cached, &cache);
+		double cached_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		bool same = plain.size() == cached.size();
+		for (int k = 0; same && k < plain.size(); k++)
+			same = plain[k].quad == cached[k].quad && plain[k].pos.x == cached[k].pos.x && plain[k].pos.y == cached[k].pos.y &&
+				plain[k].type == cached[k].type;
+		printf("  singularities: %d, %.2f ms, with the cache %.2f ms, %s\n", (int)plain.size(), plain_ms, cached_ms,
+			same ? "same" : "DIFFERENT");
+
+		// cell walk, whose segment lengths follow the curvature
+		std::vector<icVector2> seeds;
+		random_points(sampler, nseeds, 12345, seeds);
+		CellTraceParams walk;
+		walk.max_segments = 1000;
+		std::vector<icVector2> ends[2], points;
+		double walk_ms[2];
+		long long segments = 0;
+		for (int pass = 0; pass < 2; pass++) {
+			walk.cache = pass == 0 ? NULL : &cache;
+			start = std::chrono::steady_clock::now();
+			for (int k = 0; k < nseeds; k++) {
+				points.clear();
+				segments += trace_cells(sampler, seeds[k], k % 2 == 0, walk, points);
+				ends[pass].push_back(points.empty() ? seeds[k] : points.back());
+			}
+			walk_ms[pass] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		printf("  cell walk: %lld segments, %.1f ms, with the cache %.1f ms, %s\n", segments / 2, walk_ms[0], walk_ms[1],
+			ends[0] == ends[1] ? "same" : "DIFFERENT");
+
+		// placement, where the cache ends streamlines in slow quads
+		PlacementParams params = base;
+		params.trace = false;
+		int nlines[2], npoints[2], slow[2];
+		long long nsteps[2];
+		double place_ms[2];
+		for (int pass = 0; pass < 2; pass++) {
+			ctx->engine->set_cache(pass == 0 ? NULL : &cache);
+			start = std::chrono::steady_clock::now();
+			ctx->engine->run(params);
+			place_ms[pass] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			nlines[pass] = ctx->engine->streamlines.nlines();
+			npoints[pass] = ctx->engine->streamlines.npoints();
+			slow[pass] = ctx->engine->slow_stops();
+			nsteps[pass] = ctx->engine->nsteps();
+		}
+		ctx->engine->set_cache(NULL);
+		printf("  placement: %d lines, %d points, %lld steps, %d slow stops, %.1f ms; with the cache %d lines, %d points, "
+			"%lld steps, %d slow stops, %.1f ms\n", nlines[0], npoints[0], nsteps[0], slow[0], place_ms[0], nlines[1], npoints[1],
+			nsteps[1], slow[1], place_ms[1]);
+
+		// curvature simplification of the placed streamlines
+		const StreamlineSet& lines = ctx->engine->streamlines;
+		const double turns[] = { 0.02, 0.05, 0.1 };
+		for (int t = 0; t < 3; t++) {
+			int kept = 0;
+			double worst = 0;
+			std::vector<icVector2> line, simple;
+			for (int l = 0; l < lines.nlines(); l++) {
+				line.clear();
+				for (int k = lines.line_begin(l); k < lines.line_end(l); k++)
+					line.push_back(lines.point(k));
+				kept += simplify_by_curvature(cache, line.data(), (int)line.size(), turns[t], simple);
+				for (int k = 0; k < line.size(); k++) {
+					double d = polyline_distance(line[k], simple);
+					if (d > worst)
+						worst = d;
+				}
+			}
+			printf("  simplified to %.2f rad: %d of %d points kept, largest deviation %.2e\n", turns[t], kept, lines.npoints(), worst);
+		}
+		delete ctx;
+	}
+	return failed == 0 ? 0 : 1;
+}
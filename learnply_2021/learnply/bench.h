@@ -0,0 +1,36 @@
+/*
+
+Benchmarks of the tracers and samplers
+
+The command line drivers that time one way of tracing or sampling a field
+against another and check that both give the same results. Each loads
+every file it is given in turn, prints a report for it and returns 0 if
+all of them could be read.
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldContext.h"
+
+// n pseudo-random points, uniform over the bounds of the mesh of field;
+// the same seed gives the same points on every platform
+void random_points(const FieldSampler& field, int n, unsigned seed, std::vector<icVector2>& out);
+
+// learnply -tracebench: the specialized tracers of policyTracer.h against
+// the generic one, their speed and how far the endpoints are apart
+int run_trace_bench(const std::vector<const char*>& files);
+
+// learnply -floatreport: the same seeds traced on the double field and on
+// its float copy, in double and in float arithmetic, and how far the
+// endpoints move
+int run_float_report(const std::vector<const char*>& files);
+
+// learnply -resample n: each field resampled onto a regular grid, n nodes
+// along its longer side, against the mesh: error and sampling speed
+int run_resample(const std::vector<const char*>& files, int resolution, int nthreads);
+
+// learnply -cellcache: the singularity search, the cell walk and the
+// placement with base, each with and without the per-quad derivative
+// cache, and the curvature simplification of the placed streamlines
+int run_cell_cache(const std::vector<const char*>& files, const PlacementParams& base);
@@ -0,0 +1,107 @@
+/*
+
+Per-quad derivative cache of the vertex vector field
+
+*/
+
+#include <math.h>
+#include "cellCache.h"
+
+CellCache::CellCache(const FieldSampler* field_in)
+{
+	field = field_in;
+	int n = (int)field->f11.size();
+	a00.resize(n); a10.resize(n); a01.resize(n); a11.resize(n);
+	b00.resize(n); b10.resize(n); b01.resize(n); b11.resize(n);
+	min_speed.resize(n); max_speed.resize(n);
+
+	for (int i = 0; i < n; i++)
+		compute(i);
+}
+
+void CellCache::compute(int i)
+{
+	const FieldSampler& f = *field;
+	a00[i] = f.f11[i];
+	a10[i] = f.f21[i] - f.f11[i];
+	a01[i] = f.f12[i] - f.f11[i];
+	a11[i] = f.f11[i] - f.f21[i] - f.f12[i] + f.f22[i];
+	b00[i] = f.g11[i];
+	b10[i] = f.g21[i] - f.g11[i];
+	b01[i] = f.g12[i] - f.g11[i];
+	b11[i] = f.g11[i] - f.g21[i] - f.g12[i] + f.g22[i];
+
+	double fs[4] = { f.f11[i], f.f21[i], f.f12[i], f.f22[i] };
+	double gs[4] = { f.g11[i], f.g21[i], f.g12[i], f.g22[i] };
+	double fmin = fs[0], fmax = fs[0], gmin = gs[0], gmax = gs[0], vmax2 = 0;
+	for (int k = 0; k < 4; k++) {
+		fmin = fs[k] < fmin ? fs[k] : fmin;
+		fmax = fs[k] > fmax ? fs[k] : fmax;
+		gmin = gs[k] < gmin ? gs[k] : gmin;
+		gmax = gs[k] > gmax ? gs[k] : gmax;
+		double v2 = fs[k] * fs[k] + gs[k] * gs[k];
+		vmax2 = v2 > vmax2 ? v2 : vmax2;
+	}
+	// distance from the origin to [fmin,fmax] x [gmin,gmax]
+	double df = fmin > 0 ? fmin : (fmax < 0 ? -fmax : 0);
+	double dg = gmin > 0 ? gmin : (gmax < 0 ? -gmax : 0);
+	min_speed[i] = sqrt(df * df + dg * dg);
+	max_speed[i] = sqrt(vmax2);
+}
+
+void CellCache::update(const std::vector<int>& quads)
+{
+	for (int i = 0; i < quads.size(); i++)
+		compute(quads[i]);
+}
+
+double CellCache::curvature(int cell, double x, double y) const
+{
+	double s = (x - field->index->qx1[cell]) * field->inv_w[cell];
+	double t = (y - field->index->qy1[cell]) * field->inv_h[cell];
+	double vx = a00[cell] + a10[cell] * s + a01[cell] * t + a11[cell] * s * t;
+	double vy = b00[cell] + b10[cell] * s + b01[cell] * t + b11[cell] * s * t;
+	double speed2 = vx * vx + vy * vy;
+	if (speed2 == 0)
+		return 0;
+	double j[2][2];
+	jacobian(cell, x, y, j);
+	double ax = j[0][0] * vx + j[0][1] * vy, ay = j[1][0] * vx + j[1][1] * vy;
+	return fabs(vx * ay - vy * ax) / (speed2 * sqrt(speed2));
+}
+
+size_t CellCache::memory_bytes() const
+{
+	return 10 * a00.capacity() * sizeof(double);
+}
+
+int simplify_by_curvature(const CellCache& cache, const icVector2* points, int n, double max_turn, std::vector<icVector2>& out)
+{
+	out.clear();
+	if (n <= 2) {
+		out.insert(out.end(), points, points + n);
+		return (int)out.size();
+	}
+	const CellIndex& index = *cache.field->index;
+	out.push_back(points[0]);
+	double turn = 0;
+	int cell = -1;
+	double k_prev = 0;
+	for (int i = 0; i < n; i++) {
+		// consecutive points are mostly in the same quad
+		const icVector2& p = points[i];
+		if (cell < 0 || p.x < index.qx1[cell] || p.x > index.qx2[cell] || p.y < index.qy1[cell] || p.y > index.qy2[cell])
+			cell = index.find_quad_id(p.x, p.y);
+		double k = cell >= 0 ? cache.curvature(cell, p.x, p.y) : 0;
+		if (i > 0) {
+			turn += 0.5 * (k + k_prev) * length(p - points[i - 1]);
+			if (turn >= max_turn && i < n - 1) {
+				out.push_back(p);
+				turn = 0;
+			}
+		}
+		k_prev = k;
+	}
+	out.push_back(points[n - 1]);
+	return (int)out.size();
+}
@@ -0,0 +1,82 @@
+/*
+
+Per-quad derivative cache of the vertex vector field
+
+Inside quad i the field is bilinear in the local coordinates s and t,
+which go from 0 to 1 across it:
+
+	f(s,t) = a00 + a10 s + a01 t + a11 s t
+	g(s,t) = b00 + b10 s + b01 t + b11 s t
+
+CellCache keeps these coefficients for every quad, from which the
+Jacobian anywhere in the quad is two multiply-adds per entry, and bounds
+on the field magnitude over the quad: the largest magnitude (reached at
+a corner, since the field is affine along every side and every line of
+constant s or t) and a lower bound, the distance from the origin to the
+box spanned by the corner vectors. A quad whose lower bound is above
+zero has no singularity.
+
+Building the cache is optional; the streamline tracers, the placement
+engine and the singularity search read it when they are given one, and
+compute the same things from the FieldSampler otherwise.
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldSampler.h"
+
+class CellCache
+{
+public:
+
+	// fields
+	const FieldSampler* field;
+
+	// bilinear coefficients of every quad, indexed like poly->qlist
+	std::vector<double> a00, a10, a01, a11;
+	std::vector<double> b00, b10, b01, b11;
+	// bounds of the field magnitude over every quad
+	std::vector<double> min_speed, max_speed;
+
+	// constructors
+
+	CellCache(const FieldSampler* field);
+
+	// methods
+
+	// Jacobian of the field at (x,y) in quad cell:
+	// j[0] = (df/dx, df/dy), j[1] = (dg/dx, dg/dy)
+	void jacobian(int cell, double x, double y, double j[2][2]) const
+	{
+		double s = (x - field->index->qx1[cell]) * field->inv_w[cell];
+		double t = (y - field->index->qy1[cell]) * field->inv_h[cell];
+		j[0][0] = (a10[cell] + a11[cell] * t) * field->inv_w[cell];
+		j[0][1] = (a01[cell] + a11[cell] * s) * field->inv_h[cell];
+		j[1][0] = (b10[cell] + b11[cell] * t) * field->inv_w[cell];
+		j[1][1] = (b01[cell] + b11[cell] * s) * field->inv_h[cell];
+	}
+
+	// curvature of the streamline through (x,y) in quad cell, |v x Jv| / |v|^3;
+	// 0 where the field is zero
+	double curvature(int cell, double x, double y) const;
+
+	// true if the field magnitude stays below speed all over quad cell
+	bool slower_than(int cell, double speed) const { return max_speed[cell] < speed; }
+
+	// recomputes quads after FieldSampler::update
+	void update(const std::vector<int>& quads);
+
+	size_t memory_bytes() const;
+
+private:
+
+	void compute(int cell);
+};
+
+// drops the points of a polyline whose removal turns it by less than
+// max_turn radians, measured as the streamline curvature from cache
+// integrated along the arc: a point is kept once the curvature integral
+// since the last kept point reaches max_turn. The first and last points
+// are always kept. Returns the number of points in out.
+int simplify_by_curvature(const CellCache& cache, const icVector2* points, int n, double max_turn, std::vector<icVector2>& out);
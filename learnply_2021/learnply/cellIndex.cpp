@@ -0,0 +1,177 @@
+/*
+
+Uniform grid index over the quads and vertices of a polyhedron
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include "cellIndex.h"
+
+/******************************************************************************
+Build the index. The bin size is the average quad extent, so a bin
+overlaps only a handful of quads on both regular and irregular meshes.
+******************************************************************************/
+
+CellIndex::CellIndex(Polyhedron* poly_in)
+{
+	poly = poly_in;
+
+	int nquads = poly->nquads;
+	qx1.resize(nquads);
+	qx2.resize(nquads);
+	qy1.resize(nquads);
+	qy2.resize(nquads);
+
+	xmin = ymin = DBL_MAX;
+	xmax = ymax = -DBL_MAX;
+	double avg_w = 0, avg_h = 0;
+	for (int i = 0; i < nquads; i++) {
+		Quad* quad = poly->qlist[i];
+		qx1[i] = poly->smallest_x(quad);
+		qx2[i] = poly->largest_x(quad);
+		qy1[i] = poly->smallest_y(quad);
+		qy2[i] = poly->largest_y(quad);
+		xmin = fmin(xmin, qx1[i]);
+		xmax = fmax(xmax, qx2[i]);
+		ymin = fmin(ymin, qy1[i]);
+		ymax = fmax(ymax, qy2[i]);
+		avg_w += qx2[i] - qx1[i];
+		avg_h += qy2[i] - qy1[i];
+	}
+	for (int i = 0; i < poly->nverts; i++) {
+		Vertex* v = poly->vlist[i];
+		xmin = fmin(xmin, v->x);
+		xmax = fmax(xmax, v->x);
+		ymin = fmin(ymin, v->y);
+		ymax = fmax(ymax, v->y);
+	}
+
+	nx = ny = 1;
+	if (nquads > 0) {
+		avg_w /= nquads;
+		avg_h /= nquads;
+		if (avg_w > 0) nx = (int)ceil((xmax - xmin) / avg_w);
+		if (avg_h > 0) ny = (int)ceil((ymax - ymin) / avg_h);
+		// keep the bin count in the order of the quad count
+		while ((double)nx * ny > 4.0 * nquads + 16) {
+			nx = (nx + 1) / 2;
+			ny = (ny + 1) / 2;
+		}
+		nx = nx < 1 ? 1 : nx;
+		ny = ny < 1 ? 1 : ny;
+	}
+	dx = xmax > xmin ? (xmax - xmin) / nx : 1.0;
+	dy = ymax > ymin ? (ymax - ymin) / ny : 1.0;
+
+	int nbins = nx * ny;
+
+	/* bucket the quads by their bounds, counting first */
+	quad_start.assign(nbins + 1, 0);
+	for (int pass = 0; pass < 2; pass++) {
+		std::vector<int> fill;
+		if (pass == 1) {
+			for (int b = 0; b < nbins; b++)
+				quad_start[b + 1] += quad_start[b];
+			quad_items.resize(quad_start[nbins]);
+			fill.assign(quad_start.begin(), quad_start.end() - 1);
+		}
+		for (int i = 0; i < nquads; i++) {
+			int bx1 = bin_x(qx1[i]), bx2 = bin_x(qx2[i]);
+			int by1 = bin_y(qy1[i]), by2 = bin_y(qy2[i]);
+			for (int by = by1; by <= by2; by++)
+				for (int bx = bx1; bx <= bx2; bx++) {
+					int b = by * nx + bx;
+					if (pass == 0)
+						quad_start[b + 1]++;
+					else
+						quad_items[fill[b]++] = i;
+				}
+		}
+	}
+
+	/* bucket the vertices by position */
+	vert_start.assign(nbins + 1, 0);
+	for (int i = 0; i < poly->nverts; i++)
+		vert_start[bin_y(poly->vlist[i]->y) * nx + bin_x(poly->vlist[i]->x) + 1]++;
+	for (int b = 0; b < nbins; b++)
+		vert_start[b + 1] += vert_start[b];
+	vert_items.resize(vert_start[nbins]);
+	std::vector<int> fill(vert_start.begin(), vert_start.end() - 1);
+	for (int i = 0; i < poly->nverts; i++)
+		vert_items[fill[bin_y(poly->vlist[i]->y) * nx + bin_x(poly->vlist[i]->x)]++] = i;
+}
+
+int CellIndex::bin_x(double x) const
+{
+	int b = (int)floor((x - xmin) / dx);
+	return b < 0 ? 0 : (b >= nx ? nx - 1 : b);
+}
+
+int CellIndex::bin_y(double y) const
+{
+	int b = (int)floor((y - ymin) / dy);
+	return b < 0 ? 0 : (b >= ny ? ny - 1 : b);
+}
+
+/******************************************************************************
+Queries
+******************************************************************************/
+
+int CellIndex::find_quad_id(double x, double y) const
+{
+	if (!(x >= xmin && x <= xmax && y >= ymin && y <= ymax))
+		return -1;
+
+	// items of a bin are in qlist order, so the first hit is the one
+	// the linear scan would have found
+	int b = bin_y(y) * nx + bin_x(x);
+	for (int k = quad_start[b]; k < quad_start[b + 1]; k++) {
+		int i = quad_items[k];
+		if (x >= qx1[i] && x <= qx2[i] && y >= qy1[i] && y <= qy2[i])
+			return i;
+	}
+	return -1;
+}
+
+Quad* CellIndex::find_quad(double x, double y) const
+{
+	int i = find_quad_id(x, y);
+	return i < 0 ? NULL : poly->qlist[i];
+}
+
+Vertex* CellIndex::find_vertex(double x, double y) const
+{
+	if (!(x >= xmin && x <= xmax && y >= ymin && y <= ymax))
+		return NULL;
+
+	int b = bin_y(y) * nx + bin_x(x);
+	for (int k = vert_start[b]; k < vert_start[b + 1]; k++) {
+		Vertex* v = poly->vlist[vert_items[k]];
+		if (v->x == x && v->y == y)
+			return v;
+	}
+	return NULL;
+}
+
+Vertex* CellIndex::nearest_vertex(double x, double y, double max_dist) const
+{
+	Vertex* best = NULL;
+	double best_d2 = max_dist * max_dist;
+
+	int bx1 = bin_x(x - max_dist), bx2 = bin_x(x + max_dist);
+	int by1 = bin_y(y - max_dist), by2 = bin_y(y + max_dist);
+	for (int by = by1; by <= by2; by++)
+		for (int bx = bx1; bx <= bx2; bx++) {
+			int b = by * nx + bx;
+			for (int k = vert_start[b]; k < vert_start[b + 1]; k++) {
+				Vertex* v = poly->vlist[vert_items[k]];
+				double d2 = (v->x - x) * (v->x - x) + (v->y - y) * (v->y - y);
+				if (d2 <= best_d2) {
+					best_d2 = d2;
+					best = v;
+				}
+			}
+		}
+	return best;
+}
@@ -0,0 +1,56 @@
+/*
+
+Uniform grid index over the quads and vertices of a polyhedron
+
+Replaces the linear scans of Polyhedron::find_quad and of the vertex
+lookups by a bucket lookup in the xy plane.
+
+*/
+
+#pragma once
+#include <vector>
+#include "polyhedron.h"
+
+class CellIndex
+{
+public:
+
+	// fields
+	double xmin, ymin, xmax, ymax;	// extent of the indexed mesh
+	int nx, ny;						// number of bins in x and y
+	double dx, dy;					// size of a bin
+
+	// per-quad axis aligned bounds, indexed like poly->qlist
+	std::vector<double> qx1, qx2, qy1, qy2;
+
+	// constructors
+
+	CellIndex(Polyhedron* poly);
+
+	// methods
+
+	// same result as Polyhedron::find_quad: the first quad in qlist whose
+	// bounds contain (x,y), or NULL
+	Quad* find_quad(double x, double y) const;
+	int find_quad_id(double x, double y) const;
+
+	// vertex with exactly these coordinates, or NULL
+	Vertex* find_vertex(double x, double y) const;
+
+	// vertex closest to (x,y) within max_dist, or NULL
+	Vertex* nearest_vertex(double x, double y, double max_dist) const;
+
+	Polyhedron* mesh() const { return poly; }
+
+private:
+
+	Polyhedron* poly;
+
+	// bins are stored compressed: the items of bin b are
+	// items[start[b]] .. items[start[b+1]-1]
+	std::vector<int> quad_start, quad_items;
+	std::vector<int> vert_start, vert_items;
+
+	int bin_x(double x) const;
+	int bin_y(double y) const;
+};
@@ -0,0 +1,176 @@
+/*
+
+Cell-wise streamline tracing in bilinear quads
+
+*/
+
+#include <math.h>
+#include "cellTracer.h"
+
+// the flow leaving a quad through a side is handed to the quad beyond it by
+// looking up a point this far (relative to the quad size) past the side
+static const double NUDGE = 1e-9;
+
+// a streamline that starts on a side and comes back to it within this
+// fraction of the segment time grazes the side; it slides along it
+// instead, which moves it by less than (GRAZE/2)^2 of the segment length
+// off the true path
+static const double GRAZE = 1e-3;
+
+// smallest root in (0, limit) of a t^2 + b t + c, or limit if there is none
+static double first_root(double a, double b, double c, double limit)
+{
+	double roots[2];
+	int n = 0;
+	if (fabs(a) <= 1e-14 * fabs(b)) {
+		if (b != 0)
+			roots[n++] = -c / b;
+	}
+	else {
+		double disc = b * b - 4 * a * c;
+		if (disc < 0)
+			return limit;
+		double q = -0.5 * (b + (b >= 0 ? sqrt(disc) : -sqrt(disc)));
+		roots[n++] = q / a;
+		if (q != 0)
+			roots[n++] = c / q;
+	}
+	for (int i = 0; i < n; i++)
+		if (roots[i] > 0 && roots[i] < limit)
+			limit = roots[i];
+	return limit;
+}
+
+// cell_segment; hopped is set once p has been nudged into cell, so the
+// nudge is only followed by one more segment
+static int segment(const FieldSampler& field, int cell, const icVector2& p, bool forward,
+	const CellTraceParams& params, icVector2& q, double& speed, bool hopped)
+{
+	const CellIndex& index = *field.index;
+	int i = cell;
+	double x1 = index.qx1[i], x2 = index.qx2[i];
+	double y1 = index.qy1[i], y2 = index.qy2[i];
+
+	// field and Jacobian of the bilinear interpolant at p
+	icVector2 v;
+	field.sample_in_cell(i, p.x, p.y, v);
+	speed = length(v);
+	q = p;
+	if (speed == 0)
+		return CELL_ZERO;
+	double j[2][2];
+	if (params.cache != NULL)
+		params.cache->jacobian(i, p.x, p.y, j);
+	else {
+		double s = (p.x - x1) * field.inv_w[i], t = (p.y - y1) * field.inv_h[i];
+		double a10 = field.f21[i] - field.f11[i], a01 = field.f12[i] - field.f11[i];
+		double a11 = field.f11[i] - field.f21[i] - field.f12[i] + field.f22[i];
+		double b10 = field.g21[i] - field.g11[i], b01 = field.g12[i] - field.g11[i];
+		double b11 = field.g11[i] - field.g21[i] - field.g12[i] + field.g22[i];
+		j[0][0] = (a10 + a11 * t) * field.inv_w[i];
+		j[0][1] = (a01 + a11 * s) * field.inv_h[i];
+		j[1][0] = (b10 + b11 * t) * field.inv_w[i];
+		j[1][1] = (b01 + b11 * s) * field.inv_h[i];
+	}
+
+	// velocity u and acceleration J v of the streamline; going backward
+	// flips the velocity but not the acceleration
+	icVector2 u = forward ? v : -1.0 * v;
+	icVector2 acc(j[0][0] * v.x + j[0][1] * v.y, j[1][0] * v.x + j[1][1] * v.y);
+
+	// time limits from the segment length and from the bending
+	double tau = params.max_length / speed;
+	double bend = length(acc);
+	if (bend * tau > params.max_turn * speed)
+		tau = params.max_turn * speed / bend;
+
+	// first side the parabola meets; a point on a side the flow leaves
+	// through at once is moved across it by a tiny step and the segment
+	// goes on from there in the quad beyond, and one the flow grazes keeps it
+	double lo[2] = { x1, y1 }, hi[2] = { x2, y2 };
+	double pc[2] = { p.x, p.y }, uc[2] = { u.x, u.y }, ac[2] = { acc.x, acc.y };
+	int side = -1;
+	double full = tau;
+	for (int k = 0; k < 2; k++) {
+		bool leaving_lo = pc[k] <= lo[k] && (uc[k] < 0 || (uc[k] == 0 && ac[k] < 0));
+		bool leaving_hi = pc[k] >= hi[k] && (uc[k] > 0 || (uc[k] == 0 && ac[k] > 0));
+		if ((leaving_lo || leaving_hi) && !hopped) {
+			double nudge = NUDGE * ((x2 - x1) + (y2 - y1));
+			double over[2] = { p.x, p.y };
+			over[k] = leaving_lo ? lo[k] - nudge : hi[k] + nudge;
+			q.set(over[0], over[1]);
+			int next = index.find_quad_id(q.x, q.y);
+			if (next < 0 || next == cell)
+				return next;
+			// starts on the side, where a streamline that grazes it is caught
+			over[k] = leaving_lo ? lo[k] : hi[k];
+			icVector2 start(over[0], over[1]);
+			return segment(field, next, start, forward, params, q, speed, true);
+		}
+		// pushed straight back over the side it was handed across (the
+		// field is discontinuous there on a nonconforming mesh), or coming
+		// back to it at once: the streamline slides along the side
+		bool on_side = pc[k] <= lo[k] || pc[k] >= hi[k];
+		if (leaving_lo || leaving_hi ||
+			(on_side && first_root(0.5 * ac[k], uc[k], pc[k] - (pc[k] <= lo[k] ? lo[k] : hi[k]), full) < GRAZE * full)) {
+			uc[k] = 0;
+			ac[k] = 0;
+			continue;
+		}
+		double t_lo = first_root(0.5 * ac[k], uc[k], pc[k] - lo[k], tau);
+		if (t_lo < tau) {
+			tau = t_lo;
+			side = 2 * k;
+		}
+		double t_hi = first_root(0.5 * ac[k], uc[k], pc[k] - hi[k], tau);
+		if (t_hi < tau) {
+			tau = t_hi;
+			side = 2 * k + 1;
+		}
+	}
+
+	q.set(pc[0] + tau * uc[0] + 0.5 * tau * tau * ac[0], pc[1] + tau * uc[1] + 0.5 * tau * tau * ac[1]);
+	if (side < 0) {
+		// still inside; rounding may put q a hair outside
+		q.x = q.x < x1 ? x1 : (q.x > x2 ? x2 : q.x);
+		q.y = q.y < y1 ? y1 : (q.y > y2 ? y2 : q.y);
+		return cell;
+	}
+
+	// on the side: snap to it and look up the quad beyond
+	double nudge = NUDGE * ((x2 - x1) + (y2 - y1));
+	icVector2 beyond = q;
+	switch (side) {
+	case 0: q.x = x1; beyond.set(x1 - nudge, q.y); break;
+	case 1: q.x = x2; beyond.set(x2 + nudge, q.y); break;
+	case 2: q.y = y1; beyond.set(q.x, y1 - nudge); break;
+	case 3: q.y = y2; beyond.set(q.x, y2 + nudge); break;
+	}
+	q.x = q.x < x1 ? x1 : (q.x > x2 ? x2 : q.x);
+	q.y = q.y < y1 ? y1 : (q.y > y2 ? y2 : q.y);
+	return index.find_quad_id(beyond.x, beyond.y);
+}
+
+int cell_segment(const FieldSampler& field, int cell, const icVector2& p, bool forward,
+	const CellTraceParams& params, icVector2& q, double& speed)
+{
+	return segment(field, cell, p, forward, params, q, speed, false);
+}
+
+int trace_cells(const FieldSampler& field, const icVector2& seed, bool forward,
+	const CellTraceParams& params, std::vector<icVector2>& points)
+{
+	int cell = field.index->find_quad_id(seed.x, seed.y);
+	icVector2 p = seed, q;
+	double speed;
+	int n = 0;
+	while (cell >= 0 && n < params.max_segments) {
+		cell = cell_segment(field, cell, p, forward, params, q, speed);
+		if (cell == CELL_ZERO || speed < params.min_speed)
+			break;
+		n++;
+		points.push_back(q);
+		p = q;
+	}
+	return n;
+}
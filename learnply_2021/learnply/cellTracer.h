@@ -0,0 +1,46 @@
+/*
+
+Cell-wise streamline tracing in bilinear quads
+
+Inside a quad the field is bilinear, so a streamline can be followed
+from side to side in a few long segments instead of many short fixed
+steps. Each segment follows the second order expansion of the
+streamline at its start, x(t) = p + t v + t^2/2 J v, with v and J the
+field and its Jacobian there; the time at which this parabola meets a
+side of the quad is the smallest positive root of one quadratic per
+side, so the exit point is found directly instead of by cutting a step
+at the side it overshoots. Segments are shortened where the path bends,
+which keeps the expansion accurate in curved flow and near singularities.
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldSampler.h"
+#include "cellCache.h"
+
+// cell_segment result at a zero of the field
+const int CELL_ZERO = -2;
+
+struct CellTraceParams
+{
+	double max_length = 1.0;	// longest segment, in mesh units
+	double max_turn = 0.1;		// largest change of direction along a segment, in radians
+	int max_segments = 10000;	// trace_cells stops after this many segments
+	double min_speed = 0;		// trace_cells stops where the field magnitude is below this
+	const CellCache* cache = NULL;	// optional, the Jacobians are read from it
+};
+
+// advances from p in quad cell by one segment along the field, or against
+// it if forward is false, into q. Returns the quad of q, -1 if the segment
+// left the mesh, or CELL_ZERO (q = p) at a zero of the field; speed gets
+// the field magnitude at p. From a point on a side the flow leaves through,
+// the segment runs on in the quad beyond the side.
+int cell_segment(const FieldSampler& field, int cell, const icVector2& p, bool forward,
+	const CellTraceParams& params, icVector2& q, double& speed);
+
+// traces from seed in one direction until the streamline leaves the mesh,
+// reaches a zero or slow part of the field or max_segments; the segment
+// ends are appended to points. Returns the number of segments.
+int trace_cells(const FieldSampler& field, const icVector2& seed, bool forward,
+	const CellTraceParams& params, std::vector<icVector2>& points);
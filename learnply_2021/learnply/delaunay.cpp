@@ -0,0 +1,183 @@
+/*
+
+Incremental Delaunay triangulation of points in the plane (Bowyer-Watson)
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include "delaunay.h"
+
+// > 0 if c lies to the left of a->b
+static double orient(const icVector2& a, const icVector2& b, const icVector2& c)
+{
+	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+int Delaunay::new_triangle(int a, int b, int c)
+{
+	int t;
+	if (!free_tris.empty()) {
+		t = free_tris.back();
+		free_tris.pop_back();
+	}
+	else {
+		t = (int)tris.size();
+		tris.push_back(DelaunayTriangle());
+		mark.push_back(0);
+	}
+	DelaunayTriangle& tri = tris[t];
+	tri.v[0] = a;
+	tri.v[1] = b;
+	tri.v[2] = c;
+	tri.n[0] = tri.n[1] = tri.n[2] = -1;
+	tri.serial = next_serial++;
+
+	// circumcircle, computed relative to a
+	const icVector2& pa = points[a];
+	double bx = points[b].x - pa.x, by = points[b].y - pa.y;
+	double cx = points[c].x - pa.x, cy = points[c].y - pa.y;
+	double d = 2 * (bx * cy - by * cx);
+	if (fabs(d) < DBL_MIN) {
+		// degenerate: an empty circle, so no point is ever inside it
+		tri.cx = pa.x;
+		tri.cy = pa.y;
+		tri.r2 = 0;
+		return t;
+	}
+	double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+	double ux = (cy * b2 - by * c2) / d;
+	double uy = (bx * c2 - cx * b2) / d;
+	tri.cx = pa.x + ux;
+	tri.cy = pa.y + uy;
+	tri.r2 = ux * ux + uy * uy;
+	return t;
+}
+
+void Delaunay::reset(double x1, double y1, double x2, double y2)
+{
+	points.clear();
+	tris.clear();
+	free_tris.clear();
+	mark.clear();
+	mark_stamp = 0;
+	next_serial = 0;
+
+	points.push_back(icVector2(x1, y1));
+	points.push_back(icVector2(x2, y1));
+	points.push_back(icVector2(x2, y2));
+	points.push_back(icVector2(x1, y2));
+	int t0 = new_triangle(0, 1, 2);
+	int t1 = new_triangle(0, 2, 3);
+	tris[t0].n[1] = t1;		// across 2-0
+	tris[t1].n[2] = t0;		// across 0-2
+	last = t0;
+}
+
+int Delaunay::locate(const icVector2& p) const
+{
+	int t = last >= 0 && alive(last) ? last : 0;
+	while (t >= 0 && !alive(t))
+		t = t + 1 < tris.size() ? t + 1 : -1;
+
+	// walk across the first edge that has p on its outer side
+	for (int steps = 0; t >= 0 && steps < tris.size(); steps++) {
+		const DelaunayTriangle& tri = tris[t];
+		int next = -2;
+		for (int i = 0; i < 3; i++)
+			if (orient(points[tri.v[(i + 1) % 3]], points[tri.v[(i + 2) % 3]], p) < 0) {
+				next = tri.n[i];
+				break;
+			}
+		if (next == -2)
+			return t;
+		t = next;
+	}
+	if (t < 0)
+		return -1;
+
+	// the walk went round in circles on nearly flat triangles
+	for (t = 0; t < tris.size(); t++) {
+		if (!alive(t))
+			continue;
+		const DelaunayTriangle& tri = tris[t];
+		if (orient(points[tri.v[0]], points[tri.v[1]], p) >= 0 && orient(points[tri.v[1]], points[tri.v[2]], p) >= 0 &&
+			orient(points[tri.v[2]], points[tri.v[0]], p) >= 0)
+			return t;
+	}
+	return -1;
+}
+
+bool Delaunay::insert(const icVector2& p, std::vector<int>& created)
+{
+	created.clear();
+	int t0 = locate(p);
+	if (t0 < 0)
+		return false;
+	for (int i = 0; i < 3; i++)
+		if (points[tris[t0].v[i]].x == p.x && points[tris[t0].v[i]].y == p.y)
+			return false;
+
+	// the cavity: the triangles whose circumcircle contains p, connected
+	// to the one that contains it
+	mark_stamp++;
+	cavity.clear();
+	boundary.clear();
+	cavity.push_back(t0);
+	mark[t0] = mark_stamp;
+	for (int c = 0; c < cavity.size(); c++) {
+		int t = cavity[c];
+		for (int i = 0; i < 3; i++) {
+			int n = tris[t].n[i];
+			if (n >= 0 && mark[n] == mark_stamp)
+				continue;
+			if (n >= 0) {
+				const DelaunayTriangle& nt = tris[n];
+				double dx = p.x - nt.cx, dy = p.y - nt.cy;
+				if (dx * dx + dy * dy < nt.r2) {
+					mark[n] = mark_stamp;
+					cavity.push_back(n);
+					continue;
+				}
+			}
+			Edge e = { tris[t].v[(i + 1) % 3], tris[t].v[(i + 2) % 3], n };
+			boundary.push_back(e);
+		}
+	}
+
+	int ip = (int)points.size();
+	points.push_back(p);
+	for (int c = 0; c < cavity.size(); c++) {
+		tris[cavity[c]].v[0] = -1;
+		free_tris.push_back(cavity[c]);
+	}
+
+	// a fan of triangles (p, a, b) over the boundary edges
+	for (int e = 0; e < boundary.size(); e++) {
+		int t = new_triangle(ip, boundary[e].a, boundary[e].b);
+		created.push_back(t);
+		int outer = boundary[e].outer;
+		tris[t].n[0] = outer;
+		// the outer triangle shares a-b; the slot of the triangle it was
+		// joined to may already hold a new one, so match the vertices
+		if (outer >= 0)
+			for (int j = 0; j < 3; j++)
+				if (tris[outer].v[j] != boundary[e].a && tris[outer].v[j] != boundary[e].b)
+					tris[outer].n[j] = t;
+	}
+	// neighbours within the fan: (p,a,b) meets (p,b,c) across p-b and (p,z,a) across p-a
+	for (int i = 0; i < created.size(); i++)
+		for (int j = 0; j < created.size(); j++) {
+			if (i == j)
+				continue;
+			DelaunayTriangle& ti = tris[created[i]];
+			const DelaunayTriangle& tj = tris[created[j]];
+			if (tj.v[1] == ti.v[2])
+				ti.n[1] = created[j];
+			if (tj.v[2] == ti.v[1])
+				ti.n[2] = created[j];
+		}
+
+	last = created.empty() ? -1 : created[0];
+	return true;
+}
@@ -0,0 +1,65 @@
+/*
+
+Incremental Delaunay triangulation of points in the plane (Bowyer-Watson)
+
+The triangulation starts as the two triangles of a box that has to hold
+every point inserted later. A new point removes the triangles whose
+circumcircle contains it and fills the hole with a fan of triangles
+around it. The triangle that contains the point is found by walking
+from the triangle of the previous insertion, which is close by when the
+points come in along a curve.
+
+Triangle slots are reused; serial tells a triangle from an earlier one
+in the same slot, so callers can keep triangle ids in lazy queues.
+
+*/
+
+#pragma once
+#include <vector>
+#include "icVector.H"
+
+struct DelaunayTriangle
+{
+	int v[3];			// points, counterclockwise; v[0] is -1 for a free slot
+	int n[3];			// triangle across the edge opposite v[i], -1 outside the box
+	double cx, cy, r2;	// circumcircle
+	int serial;
+};
+
+class Delaunay
+{
+public:
+
+	// fields
+	std::vector<icVector2> points;		// the 4 box corners, then the inserted points
+	std::vector<DelaunayTriangle> tris;
+
+	// methods
+
+	// starts over with the box [x1,x2] x [y1,y2]; the buffers keep their capacity
+	void reset(double x1, double y1, double x2, double y2);
+
+	// inserts p; created gets the ids of the new triangles. False if p is
+	// outside the box or on a point inserted before.
+	bool insert(const icVector2& p, std::vector<int>& created);
+
+	bool alive(int t) const { return tris[t].v[0] >= 0; }
+
+	// triangle that contains p, or -1 if p is outside the box
+	int locate(const icVector2& p) const;
+
+private:
+
+	std::vector<int> free_tris;
+	int last;				// start of the next walk
+	int next_serial;
+
+	// scratch space of insert
+	std::vector<int> mark;
+	int mark_stamp;
+	std::vector<int> cavity;
+	struct Edge { int a, b, outer; };
+	std::vector<Edge> boundary;
+
+	int new_triangle(int a, int b, int c);
+};
@@ -0,0 +1,64 @@
+/*
+
+A loaded vector field and everything derived from it
+
+*/
+
+#include <stdio.h>
+#include <mutex>
+#include "fieldContext.h"
+
+// the ply reader keeps file-scope state (in_ply, static line buffers)
+static std::mutex ply_lock;
+
+FieldContext* FieldContext::load(const char* filename)
+{
+	FILE* this_file = fopen(filename, "r");
+	if (this_file == NULL) {
+		fprintf(stderr, "Could not open %s.\n", filename);
+		return NULL;
+	}
+
+	FieldContext* field = new FieldContext();
+	field->filename = filename;
+	{
+		std::lock_guard<std::mutex> hold(ply_lock);
+		field->poly = new Polyhedron(this_file);	// the ply reader closes the file
+	}
+
+	/*initialize the mesh*/
+	Polyhedron* poly = field->poly;
+	poly->initialize();
+	for (int i = 0; i < poly->nquads; i++)
+		poly->qlist[i]->singularity = NULL;
+
+	field->index = new CellIndex(poly);
+	field->sampler = new FieldSampler(field->index);
+	field->engine = new StreamlineEngine(field->sampler);
+	return field;
+}
+
+FieldContext::~FieldContext()
+{
+	delete engine;
+	delete sampler;
+	delete index;
+	for (int i = 0; i < poly->nquads; i++) {
+		delete poly->qlist[i]->singularity;
+		poly->qlist[i]->singularity = NULL;
+	}
+	poly->finalize();
+	delete poly;
+}
+
+std::string FieldContext::name() const
+{
+	std::string name = filename;
+	size_t slash = name.find_last_of("/\\");
+	if (slash != std::string::npos)
+		name = name.substr(slash + 1);
+	size_t dot = name.rfind('.');
+	if (dot != std::string::npos)
+		name = name.substr(0, dot);
+	return name;
+}
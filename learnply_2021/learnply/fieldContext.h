@@ -0,0 +1,44 @@
+/*
+
+A loaded vector field and everything derived from it
+
+Owns the mesh read from a ply file, its CellIndex and FieldSampler and a
+StreamlineEngine placing streamlines on it. Nothing is shared between
+contexts, so several fields can be loaded and processed at the same time.
+
+*/
+
+#pragma once
+#include <string>
+#include "streamlineEngine.h"
+
+class FieldContext
+{
+public:
+
+	// fields
+	std::string filename;
+	Polyhedron* poly;
+	CellIndex* index;
+	FieldSampler* sampler;
+	StreamlineEngine* engine;
+
+	// constructors
+
+	// reads and indexes the mesh; returns NULL if the file can't be opened.
+	// The ply reader keeps global state, so loads are serialized internally
+	// and load may be called from any thread.
+	static FieldContext* load(const char* filename);
+	~FieldContext();
+
+	// methods
+
+	// file name without directory and extension
+	std::string name() const;
+
+private:
+
+	FieldContext() {}
+	FieldContext(const FieldContext&);
+	FieldContext& operator=(const FieldContext&);
+};
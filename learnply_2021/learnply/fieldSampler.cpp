@@ -0,0 +1,148 @@
+/*
+
+Bilinear sampling of the vertex vector field of a polyhedron
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include "fieldSampler.h"
+#if defined(_MSC_VER) && FIELD_SAMPLER_X86
+#include <intrin.h>
+#endif
+
+// for quads that are not axis aligned the closest vertex stands in for the corner
+Vertex* corner_vertex(Quad* quad, double x, double y)
+{
+	Vertex* best = quad->verts[0];
+	double best_d2 = DBL_MAX;
+	for (int i = 0; i < 4; i++) {
+		Vertex* v = quad->verts[i];
+		double d2 = (v->x - x) * (v->x - x) + (v->y - y) * (v->y - y);
+		if (d2 < best_d2) {
+			best_d2 = d2;
+			best = v;
+		}
+	}
+	return best;
+}
+
+FieldSampler::FieldSampler(const CellIndex* index_in)
+{
+	index = index_in;
+	Polyhedron* poly = index->mesh();
+
+	int n = poly->nquads;
+	f11.resize(n); f21.resize(n); f12.resize(n); f22.resize(n);
+	g11.resize(n); g21.resize(n); g12.resize(n); g22.resize(n);
+	inv_w.resize(n); inv_h.resize(n);
+
+	for (int i = 0; i < n; i++)
+		gather(i);
+}
+
+void FieldSampler::gather(int i)
+{
+	Quad* quad = index->mesh()->qlist[i];
+	double x1 = index->qx1[i], x2 = index->qx2[i];
+	double y1 = index->qy1[i], y2 = index->qy2[i];
+	Vertex* v11 = corner_vertex(quad, x1, y1);
+	Vertex* v21 = corner_vertex(quad, x2, y1);
+	Vertex* v12 = corner_vertex(quad, x1, y2);
+	Vertex* v22 = corner_vertex(quad, x2, y2);
+	f11[i] = v11->vx; g11[i] = v11->vy;
+	f21[i] = v21->vx; g21[i] = v21->vy;
+	f12[i] = v12->vx; g12[i] = v12->vy;
+	f22[i] = v22->vx; g22[i] = v22->vy;
+	inv_w[i] = 1.0 / (x2 - x1);
+	inv_h[i] = 1.0 / (y2 - y1);
+}
+
+void FieldSampler::update(const std::vector<int>& quads)
+{
+	for (int i = 0; i < quads.size(); i++)
+		gather(quads[i]);
+}
+
+void FieldSampler::sample_in_cell(int i, double x0, double y0, icVector2& v) const
+{
+	double wx2 = (x0 - index->qx1[i]) * inv_w[i], wx1 = (index->qx2[i] - x0) * inv_w[i];
+	double wy2 = (y0 - index->qy1[i]) * inv_h[i], wy1 = (index->qy2[i] - y0) * inv_h[i];
+	v.x = wy1 * (wx1 * f11[i] + wx2 * f21[i]) + wy2 * (wx1 * f12[i] + wx2 * f22[i]);
+	v.y = wy1 * (wx1 * g11[i] + wx2 * g21[i]) + wy2 * (wx1 * g12[i] + wx2 * g22[i]);
+}
+
+bool FieldSampler::sample(double x, double y, icVector2& v) const
+{
+	int cell = index->find_quad_id(x, y);
+	if (cell < 0)
+		return false;
+	sample_in_cell(cell, x, y, v);
+	return true;
+}
+
+/******************************************************************************
+Batch sampling. Every lane does the arithmetic of sample_in_cell in the
+same order; lanes whose cell is -1 gather nothing and come out zero. The
+AVX2 and AVX-512 kernels live in fieldSamplerAvx2.cpp and
+fieldSamplerAvx512.cpp and are picked once, from what the processor and
+the operating system support.
+******************************************************************************/
+
+int FieldSampler::vector_width()
+{
+#if FIELD_SAMPLER_X86 && defined(_MSC_VER)
+	int r[4];
+	__cpuid(r, 0);
+	if (r[0] < 7)
+		return 1;
+	__cpuid(r, 1);
+	if (!(r[2] & (1 << 27)))		// OSXSAVE: xgetbv is there
+		return 1;
+	unsigned long long xcr0 = _xgetbv(0);
+	__cpuidex(r, 7, 0);
+	// the OS saves the AVX-512 mask and upper registers, and the YMM ones
+	if ((r[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6)
+		return 8;
+	if ((r[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6)
+		return 4;
+	return 1;
+#elif FIELD_SAMPLER_X86 && defined(__GNUC__)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return 8;
+	if (__builtin_cpu_supports("avx2"))
+		return 4;
+	return 1;
+#else
+	return 1;
+#endif
+}
+
+void FieldSampler::sample_batch(int n, const int* cells, const double* x, const double* y,
+	double* vx, double* vy, bool normalize, double* speed) const
+{
+	int i = 0;
+#if FIELD_SAMPLER_X86
+	static const int width = vector_width();
+	if (width == 8)
+		i = sample_batch_avx512(*this, n, cells, x, y, vx, vy, normalize, speed);
+	else if (width == 4)
+		i = sample_batch_avx2(*this, n, cells, x, y, vx, vy, normalize, speed);
+#endif
+	// the rest, or everything without AVX2
+	for (; i < n; i++) {
+		icVector2 v(0, 0);
+		if (cells[i] >= 0)
+			sample_in_cell(cells[i], x[i], y[i], v);
+		if (normalize) {
+			double len = length(v);
+			if (len != 0)
+				v *= 1 / len;
+			if (speed != NULL)
+				speed[i] = len;
+		}
+		vx[i] = v.x;
+		vy[i] = v.y;
+	}
+}
@@ -0,0 +1,85 @@
+/*
+
+Bilinear sampling of the vertex vector field of a polyhedron
+
+The corner vectors of every quad are gathered once, so a sample costs a
+cell lookup and the bilinear weights instead of the find_quad and four
+find_vertex scans done by calculate_vector.
+
+The corner vectors and the inverse quad extents are kept as one array
+per component, so sample_batch can gather them for 8 (AVX-512) or 4
+(AVX2) points per instruction when the processor has those sets.
+
+*/
+
+#pragma once
+#include <vector>
+#include "cellIndex.h"
+
+// the vector kernels of sample_batch are only built for x86
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define FIELD_SAMPLER_X86 1
+#else
+#define FIELD_SAMPLER_X86 0
+#endif
+
+// vertex of quad sitting on corner (x,y) of its bounds
+Vertex* corner_vertex(Quad* quad, double x, double y);
+
+class FieldSampler
+{
+public:
+
+	typedef double storage_type;
+
+	// fields
+	const CellIndex* index;
+
+	// vector components at the corners (x1,y1), (x2,y1), (x1,y2), (x2,y2)
+	// of every quad, indexed like poly->qlist
+	std::vector<double> f11, f21, f12, f22;
+	std::vector<double> g11, g21, g12, g22;
+	// 1/(x2-x1) and 1/(y2-y1) of every quad
+	std::vector<double> inv_w, inv_h;
+
+	// constructors
+
+	FieldSampler(const CellIndex* index);
+
+	// methods
+
+	// interpolated (not normalized) vector at (x,y); false outside the mesh
+	bool sample(double x, double y, icVector2& v) const;
+
+	// same, for a point already known to lie in quad cell
+	void sample_in_cell(int cell, double x, double y, icVector2& v) const;
+
+	// sample_in_cell for n points at once: point i is (x[i],y[i]) and lies
+	// in quad cells[i], or cells[i] is -1 for a zero vector. With normalize
+	// the vectors are scaled to unit length and, if speed is not NULL, their
+	// magnitudes are stored in speed. Gives the vectors of sample_in_cell, up
+	// to rounding where the compiler fuses the scalar multiply-adds.
+	void sample_batch(int n, const int* cells, const double* x, const double* y,
+		double* vx, double* vy, bool normalize = false, double* speed = NULL) const;
+
+	// gathers the corner vectors of quads again after their vertex vectors
+	// were edited
+	void update(const std::vector<int>& quads);
+
+	// points per iteration of the sample_batch kernel this processor runs:
+	// 8 with AVX-512, 4 with AVX2, else 1
+	static int vector_width();
+
+private:
+
+	void gather(int cell);
+};
+
+#if FIELD_SAMPLER_X86
+// the kernels of sample_batch; each samples the points up to the last
+// multiple of its width and returns that count
+int sample_batch_avx2(const FieldSampler& field, int n, const int* cells, const double* x, const double* y,
+	double* vx, double* vy, bool normalize, double* speed);
+int sample_batch_avx512(const FieldSampler& field, int n, const int* cells, const double* x, const double* y,
+	double* vx, double* vy, bool normalize, double* speed);
+#endif
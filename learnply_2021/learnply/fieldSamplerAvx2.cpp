@@ -0,0 +1,59 @@
+/*
+
+AVX2 kernel of FieldSampler::sample_batch
+
+Built for AVX2 on its own, by the project settings of this file with
+MSVC and by a target attribute with gcc and clang, so the rest of the
+program runs on any x86 processor; sample_batch only calls it when the
+processor has AVX2.
+
+*/
+
+#include "fieldSampler.h"
+#if FIELD_SAMPLER_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+#endif
+int sample_batch_avx2(const FieldSampler& field, int n, const int* cells, const double* x, const double* y,
+	double* vx, double* vy, bool normalize, double* speed)
+{
+	int i = 0;
+	const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+	for (; i + 4 <= n; i += 4) {
+		__m128i c = _mm_loadu_si128((const __m128i*)(cells + i));
+		// all ones in the lanes that have a cell
+		__m256d in = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpgt_epi32(c, _mm_set1_epi32(-1))));
+		__m256d px = _mm256_loadu_pd(x + i), py = _mm256_loadu_pd(y + i);
+		__m256d iw = _mm256_mask_i32gather_pd(zero, field.inv_w.data(), c, in, 8);
+		__m256d ih = _mm256_mask_i32gather_pd(zero, field.inv_h.data(), c, in, 8);
+		__m256d wx2 = _mm256_mul_pd(_mm256_sub_pd(px, _mm256_mask_i32gather_pd(zero, field.index->qx1.data(), c, in, 8)), iw);
+		__m256d wx1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, field.index->qx2.data(), c, in, 8), px), iw);
+		__m256d wy2 = _mm256_mul_pd(_mm256_sub_pd(py, _mm256_mask_i32gather_pd(zero, field.index->qy1.data(), c, in, 8)), ih);
+		__m256d wy1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_mask_i32gather_pd(zero, field.index->qy2.data(), c, in, 8), py), ih);
+		__m256d u = _mm256_add_pd(
+			_mm256_mul_pd(wy1, _mm256_add_pd(_mm256_mul_pd(wx1, _mm256_mask_i32gather_pd(zero, field.f11.data(), c, in, 8)),
+				_mm256_mul_pd(wx2, _mm256_mask_i32gather_pd(zero, field.f21.data(), c, in, 8)))),
+			_mm256_mul_pd(wy2, _mm256_add_pd(_mm256_mul_pd(wx1, _mm256_mask_i32gather_pd(zero, field.f12.data(), c, in, 8)),
+				_mm256_mul_pd(wx2, _mm256_mask_i32gather_pd(zero, field.f22.data(), c, in, 8)))));
+		__m256d v = _mm256_add_pd(
+			_mm256_mul_pd(wy1, _mm256_add_pd(_mm256_mul_pd(wx1, _mm256_mask_i32gather_pd(zero, field.g11.data(), c, in, 8)),
+				_mm256_mul_pd(wx2, _mm256_mask_i32gather_pd(zero, field.g21.data(), c, in, 8)))),
+			_mm256_mul_pd(wy2, _mm256_add_pd(_mm256_mul_pd(wx1, _mm256_mask_i32gather_pd(zero, field.g12.data(), c, in, 8)),
+				_mm256_mul_pd(wx2, _mm256_mask_i32gather_pd(zero, field.g22.data(), c, in, 8)))));
+		if (normalize) {
+			__m256d len = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(u, u), _mm256_mul_pd(v, v)));
+			__m256d scale = _mm256_and_pd(_mm256_cmp_pd(len, zero, _CMP_NEQ_OQ), _mm256_div_pd(one, len));
+			u = _mm256_mul_pd(u, scale);
+			v = _mm256_mul_pd(v, scale);
+			if (speed != NULL)
+				_mm256_storeu_pd(speed + i, len);
+		}
+		_mm256_storeu_pd(vx + i, u);
+		_mm256_storeu_pd(vy + i, v);
+	}
+	return i;
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*
+
+AVX-512 kernel of FieldSampler::sample_batch
+
+Built for AVX-512 on its own, by the project settings of this file with
+MSVC and by a target attribute with gcc and clang, so the rest of the
+program runs on any x86 processor; sample_batch only calls it when the
+processor has AVX-512.
+
+*/
+
+#include "fieldSampler.h"
+#if FIELD_SAMPLER_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+__attribute__((target("avx512f")))
+#endif
+int sample_batch_avx512(const FieldSampler& field, int n, const int* cells, const double* x, const double* y,
+	double* vx, double* vy, bool normalize, double* speed)
+{
+	int i = 0;
+	const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+	for (; i + 8 <= n; i += 8) {
+		__m256i c = _mm256_loadu_si256((const __m256i*)(cells + i));
+		// lanes with a cell have the sign bit of their index clear
+		__mmask8 in = (__mmask8)(~_mm256_movemask_ps(_mm256_castsi256_ps(c)) & 0xff);
+		__m512d px = _mm512_loadu_pd(x + i), py = _mm512_loadu_pd(y + i);
+		__m512d iw = _mm512_mask_i32gather_pd(zero, in, c, field.inv_w.data(), 8);
+		__m512d ih = _mm512_mask_i32gather_pd(zero, in, c, field.inv_h.data(), 8);
+		__m512d wx2 = _mm512_mul_pd(_mm512_sub_pd(px, _mm512_mask_i32gather_pd(zero, in, c, field.index->qx1.data(), 8)), iw);
+		__m512d wx1 = _mm512_mul_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, in, c, field.index->qx2.data(), 8), px), iw);
+		__m512d wy2 = _mm512_mul_pd(_mm512_sub_pd(py, _mm512_mask_i32gather_pd(zero, in, c, field.index->qy1.data(), 8)), ih);
+		__m512d wy1 = _mm512_mul_pd(_mm512_sub_pd(_mm512_mask_i32gather_pd(zero, in, c, field.index->qy2.data(), 8), py), ih);
+		__m512d u = _mm512_add_pd(
+			_mm512_mul_pd(wy1, _mm512_add_pd(_mm512_mul_pd(wx1, _mm512_mask_i32gather_pd(zero, in, c, field.f11.data(), 8)),
+				_mm512_mul_pd(wx2, _mm512_mask_i32gather_pd(zero, in, c, field.f21.data(), 8)))),
+			_mm512_mul_pd(wy2, _mm512_add_pd(_mm512_mul_pd(wx1, _mm512_mask_i32gather_pd(zero, in, c, field.f12.data(), 8)),
+				_mm512_mul_pd(wx2, _mm512_mask_i32gather_pd(zero, in, c, field.f22.data(), 8)))));
+		__m512d v = _mm512_add_pd(
+			_mm512_mul_pd(wy1, _mm512_add_pd(_mm512_mul_pd(wx1, _mm512_mask_i32gather_pd(zero, in, c, field.g11.data(), 8)),
+				_mm512_mul_pd(wx2, _mm512_mask_i32gather_pd(zero, in, c, field.g21.data(), 8)))),
+			_mm512_mul_pd(wy2, _mm512_add_pd(_mm512_mul_pd(wx1, _mm512_mask_i32gather_pd(zero, in, c, field.g12.data(), 8)),
+				_mm512_mul_pd(wx2, _mm512_mask_i32gather_pd(zero, in, c, field.g22.data(), 8)))));
+		if (normalize) {
+			__m512d len = _mm512_sqrt_pd(_mm512_add_pd(_mm512_mul_pd(u, u), _mm512_mul_pd(v, v)));
+			__m512d scale = _mm512_maskz_div_pd(_mm512_cmp_pd_mask(len, zero, _CMP_NEQ_OQ), one, len);
+			u = _mm512_mul_pd(u, scale);
+			v = _mm512_mul_pd(v, scale);
+			if (speed != NULL)
+				_mm512_storeu_pd(speed + i, len);
+		}
+		_mm512_storeu_pd(vx + i, u);
+		_mm512_storeu_pd(vy + i, v);
+	}
+	return i;
+}
+
+#endif
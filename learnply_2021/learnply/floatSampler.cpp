@@ -0,0 +1,60 @@
+/*
+
+Single-precision copy of a FieldSampler
+
+*/
+
+#include "floatSampler.h"
+
+FloatFieldSampler::FloatFieldSampler(const FieldSampler& field)
+{
+	index = field.index;
+	int n = (int)field.f11.size();
+	f11.resize(n); f21.resize(n); f12.resize(n); f22.resize(n);
+	g11.resize(n); g21.resize(n); g12.resize(n); g22.resize(n);
+	inv_w.resize(n); inv_h.resize(n);
+	qx1.resize(n); qy1.resize(n); qx2.resize(n); qy2.resize(n);
+
+	for (int i = 0; i < n; i++)
+		copy(field, i);
+}
+
+void FloatFieldSampler::copy(const FieldSampler& field, int i)
+{
+	f11[i] = (float)field.f11[i]; g11[i] = (float)field.g11[i];
+	f21[i] = (float)field.f21[i]; g21[i] = (float)field.g21[i];
+	f12[i] = (float)field.f12[i]; g12[i] = (float)field.g12[i];
+	f22[i] = (float)field.f22[i]; g22[i] = (float)field.g22[i];
+	inv_w[i] = (float)field.inv_w[i];
+	inv_h[i] = (float)field.inv_h[i];
+	qx1[i] = (float)index->qx1[i]; qx2[i] = (float)index->qx2[i];
+	qy1[i] = (float)index->qy1[i]; qy2[i] = (float)index->qy2[i];
+}
+
+void FloatFieldSampler::update(const FieldSampler& field, const std::vector<int>& quads)
+{
+	for (int i = 0; i < quads.size(); i++)
+		copy(field, quads[i]);
+}
+
+void FloatFieldSampler::sample_in_cell(int i, double x0, double y0, icVector2& v) const
+{
+	double wx2 = (x0 - qx1[i]) * inv_w[i], wx1 = (qx2[i] - x0) * inv_w[i];
+	double wy2 = (y0 - qy1[i]) * inv_h[i], wy1 = (qy2[i] - y0) * inv_h[i];
+	v.x = wy1 * (wx1 * f11[i] + wx2 * f21[i]) + wy2 * (wx1 * f12[i] + wx2 * f22[i]);
+	v.y = wy1 * (wx1 * g11[i] + wx2 * g21[i]) + wy2 * (wx1 * g12[i] + wx2 * g22[i]);
+}
+
+bool FloatFieldSampler::sample(double x, double y, icVector2& v) const
+{
+	int cell = index->find_quad_id(x, y);
+	if (cell < 0)
+		return false;
+	sample_in_cell(cell, x, y, v);
+	return true;
+}
+
+size_t FloatFieldSampler::memory_bytes() const
+{
+	return 14 * f11.capacity() * sizeof(float);
+}
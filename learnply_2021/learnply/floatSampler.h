@@ -0,0 +1,56 @@
+/*
+
+Single-precision copy of a FieldSampler
+
+The corner vectors, quad bounds and inverse quad extents are stored as
+float, half the bytes of FieldSampler and its CellIndex, so a tracer
+streams half as much memory per sample on meshes that do not fit in the
+cache. Samples are accumulated in double: only the stored values are
+rounded, not the interpolation. The CellIndex is still used, in double,
+to find the quad of a point that left the current one.
+
+The placement engine keeps the double sampler; rounding the field
+changes which seeds it accepts (see StreamlineSet).
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldSampler.h"
+
+class FloatFieldSampler
+{
+public:
+
+	typedef float storage_type;
+
+	// fields
+	const CellIndex* index;
+
+	// as in FieldSampler and CellIndex, rounded to float
+	std::vector<float> f11, f21, f12, f22;
+	std::vector<float> g11, g21, g12, g22;
+	std::vector<float> inv_w, inv_h;
+	std::vector<float> qx1, qy1, qx2, qy2;
+
+	// constructors
+
+	FloatFieldSampler(const FieldSampler& field);
+
+	// methods
+
+	// interpolated (not normalized) vector at (x,y); false outside the mesh
+	bool sample(double x, double y, icVector2& v) const;
+
+	// same, for a point already known to lie in quad cell
+	void sample_in_cell(int cell, double x, double y, icVector2& v) const;
+
+	// copies the quads of field again after their vertex vectors were edited
+	void update(const FieldSampler& field, const std::vector<int>& quads);
+
+	size_t memory_bytes() const;
+
+private:
+
+	void copy(const FieldSampler& field, int cell);
+};
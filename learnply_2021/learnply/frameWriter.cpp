@@ -0,0 +1,84 @@
+/*
+
+Encodes and writes frames on a background thread
+
+*/
+
+#include <stdio.h>
+#include "frameWriter.h"
+#include "imageIO.h"
+
+FrameWriter::FrameWriter(int max_pending_in)
+{
+	max_pending = max_pending_in < 1 ? 1 : max_pending_in;
+	busy = false;
+	stopping = false;
+	written = failed = 0;
+	worker = std::thread(&FrameWriter::run, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		stopping = true;
+	}
+	changed.notify_all();
+	worker.join();
+}
+
+// the pixels are moved into the queue, rgb is left empty
+void FrameWriter::submit(const std::string& filename, int width, int height, std::vector<unsigned char>& rgb)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (pending.size() >= max_pending)
+		changed.wait(guard);
+
+	pending.push_back(Frame());
+	Frame& frame = pending.back();
+	frame.filename = filename;
+	frame.width = width;
+	frame.height = height;
+	frame.rgb.swap(rgb);
+	changed.notify_all();
+}
+
+void FrameWriter::finish()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (!pending.empty() || busy)
+		changed.wait(guard);
+}
+
+void FrameWriter::run()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	for (;;) {
+		while (pending.empty() && !stopping)
+			changed.wait(guard);
+		if (pending.empty())
+			return;
+
+		Frame frame;
+		frame.filename.swap(pending.front().filename);
+		frame.width = pending.front().width;
+		frame.height = pending.front().height;
+		frame.rgb.swap(pending.front().rgb);
+		pending.pop_front();
+		busy = true;
+		changed.notify_all();
+
+		guard.unlock();
+		bool ok = write_image(frame.filename.c_str(), frame.width, frame.height, &frame.rgb[0]);
+		if (ok)
+			printf("wrote %s\n", frame.filename.c_str());
+		guard.lock();
+
+		if (ok)
+			written++;
+		else
+			failed++;
+		busy = false;
+		changed.notify_all();
+	}
+}
@@ -0,0 +1,61 @@
+/*
+
+Encodes and writes frames on a background thread
+
+The renderer hands a finished frame over with submit() and goes on with
+the next one while the previous frames are written.
+
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class FrameWriter
+{
+public:
+
+	// constructors
+
+	// max_pending: submit() blocks while this many frames wait to be
+	// written, which bounds the memory held by queued frames
+	FrameWriter(int max_pending = 4);
+	~FrameWriter();
+
+	// methods
+
+	// queues an RGB frame (rows from top to bottom) for writing; the format
+	// follows the file extension, see write_image
+	void submit(const std::string& filename, int width, int height, std::vector<unsigned char>& rgb);
+
+	// waits until every queued frame has been written
+	void finish();
+
+	int nwritten() const { return written; }
+	int nfailed() const { return failed; }
+
+private:
+
+	struct Frame
+	{
+		std::string filename;
+		int width, height;
+		std::vector<unsigned char> rgb;
+	};
+
+	std::deque<Frame> pending;
+	int max_pending;
+	bool busy;			// the worker is writing a frame
+	bool stopping;
+	int written, failed;
+
+	std::mutex lock;
+	std::condition_variable changed;
+	std::thread worker;
+
+	void run();
+};
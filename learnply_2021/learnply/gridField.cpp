@@ -0,0 +1,70 @@
+/*
+
+Vector field resampled onto a regular grid
+
+*/
+
+#include <thread>
+#include "gridField.h"
+
+GridField::GridField()
+{
+	nx = ny = 0;
+	x0 = y0 = 0;
+	dx = dy = inv_dx = inv_dy = 0;
+}
+
+// samples rows [first,last) of the nodes
+static void sample_rows(GridField* grid, const FieldSampler* field, int first, int last)
+{
+	for (int j = first; j < last; j++)
+		for (int i = 0; i < grid->nx; i++) {
+			int k = j * grid->nx + i;
+			icVector2 v;
+			bool on = field->sample(grid->x0 + i * grid->dx, grid->y0 + j * grid->dy, v);
+			grid->vx[k] = on ? v.x : 0;
+			grid->vy[k] = on ? v.y : 0;
+			grid->inside[k] = on ? 1 : 0;
+		}
+}
+
+void GridField::build(const FieldSampler& field, int nx_in, int ny_in, int nthreads)
+{
+	const CellIndex& index = *field.index;
+	nx = nx_in > 2 ? nx_in : 2;
+	ny = ny_in > 2 ? ny_in : 2;
+	x0 = index.xmin;
+	y0 = index.ymin;
+	dx = (index.xmax - index.xmin) / (nx - 1);
+	dy = (index.ymax - index.ymin) / (ny - 1);
+	inv_dx = dx > 0 ? 1 / dx : 0;
+	inv_dy = dy > 0 ? 1 / dy : 0;
+	vx.assign(nx * ny, 0);
+	vy.assign(nx * ny, 0);
+	inside.assign(nx * ny, 0);
+
+	if (nthreads <= 0)
+		nthreads = (int)std::thread::hardware_concurrency();
+	if (nthreads < 1)
+		nthreads = 1;
+	if (nthreads > ny)
+		nthreads = ny;
+	std::vector<std::thread> workers;
+	for (int t = 1; t < nthreads; t++)
+		workers.push_back(std::thread(sample_rows, this, &field, (int)((long long)ny * t / nthreads), (int)((long long)ny * (t + 1) / nthreads)));
+	sample_rows(this, &field, 0, ny / nthreads);
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	cell_inside.assign(nx * ny, 0);
+	for (int j = 0; j + 1 < ny; j++)
+		for (int i = 0; i + 1 < nx; i++) {
+			int k = j * nx + i;
+			cell_inside[k] = inside[k] & inside[k + 1] & inside[k + nx] & inside[k + nx + 1];
+		}
+}
+
+size_t GridField::memory_bytes() const
+{
+	return (vx.capacity() + vy.capacity()) * sizeof(double) + inside.capacity() + cell_inside.capacity();
+}
@@ -0,0 +1,69 @@
+/*
+
+Vector field resampled onto a regular grid
+
+On an irregular mesh every FieldSampler sample starts with a CellIndex
+lookup among the quads of a bin. GridField samples the field once at the
+nodes of a regular grid over the mesh bounds, after which a sample is
+index arithmetic and a bilinear blend of four nodes, like a texture
+fetch. Nodes off the mesh are marked and the grid cells touching them
+are treated as off the mesh too, so a thin strip along a non-rectangular
+boundary is lost; the resolution sets its width and the error inside.
+
+The nodes are sampled on several threads, a band of rows each.
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldSampler.h"
+
+class GridField
+{
+public:
+
+	// fields
+	int nx, ny;					// nodes along x and y
+	double x0, y0;				// first node
+	double dx, dy;				// node spacing
+	std::vector<double> vx, vy;	// field at every node, row after row
+	std::vector<unsigned char> inside;	// 1 where the node is on the mesh
+
+	// constructors
+
+	GridField();
+
+	// methods
+
+	// samples field on nx by ny nodes spanning the mesh bounds, with
+	// nthreads threads (0 for one per hardware thread)
+	void build(const FieldSampler& field, int nx, int ny, int nthreads = 0);
+
+	// bilinear vector at (x,y); false outside the grid or next to a node
+	// off the mesh
+	bool sample(double x, double y, icVector2& v) const
+	{
+		double fx = (x - x0) * inv_dx, fy = (y - y0) * inv_dy;
+		if (!(fx >= 0 && fy >= 0 && fx <= nx - 1 && fy <= ny - 1))
+			return false;
+		int i = (int)fx, j = (int)fy;
+		if (i == nx - 1) i--;
+		if (j == ny - 1) j--;
+		int k = j * nx + i;
+		if (!cell_inside[k])
+			return false;
+		double s = fx - i, t = fy - j;
+		v.x = (1 - t) * ((1 - s) * vx[k] + s * vx[k + 1]) + t * ((1 - s) * vx[k + nx] + s * vx[k + nx + 1]);
+		v.y = (1 - t) * ((1 - s) * vy[k] + s * vy[k + 1]) + t * ((1 - s) * vy[k + nx] + s * vy[k + nx + 1]);
+		return true;
+	}
+
+	size_t memory_bytes() const;
+
+private:
+
+	double inv_dx, inv_dy;
+	// 1 where all four nodes of the grid cell whose lower left node has
+	// the same index are on the mesh
+	std::vector<unsigned char> cell_inside;
+};
@@ -0,0 +1,155 @@
+/*
+
+Writing images to disk
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "imageIO.h"
+
+static bool write_pnm(const char* filename, const char* magic, int width, int height, int channels, const unsigned char* data)
+{
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open %s for writing.\n", filename);
+		return false;
+	}
+	fprintf(file, "%s\n%d %d\n255\n", magic, width, height);
+	size_t n = (size_t)width * height * channels;
+	bool ok = fwrite(data, 1, n, file) == n;
+	fclose(file);
+	return ok;
+}
+
+bool write_ppm(const char* filename, int width, int height, const unsigned char* rgb)
+{
+	return write_pnm(filename, "P6", width, height, 3, rgb);
+}
+
+bool write_pgm(const char* filename, int width, int height, const unsigned char* gray)
+{
+	return write_pnm(filename, "P5", width, height, 1, gray);
+}
+
+/******************************************************************************
+PNG output. The zlib stream uses stored (uncompressed) deflate blocks, so
+only the CRC and Adler checksums have to be computed.
+******************************************************************************/
+
+static unsigned int crc_table[256];
+static bool crc_table_ready = false;
+
+static void make_crc_table()
+{
+	for (unsigned int n = 0; n < 256; n++) {
+		unsigned int c = n;
+		for (int k = 0; k < 8; k++)
+			c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+		crc_table[n] = c;
+	}
+	crc_table_ready = true;
+}
+
+static unsigned int update_crc(unsigned int crc, const unsigned char* buf, size_t len)
+{
+	for (size_t n = 0; n < len; n++)
+		crc = crc_table[(crc ^ buf[n]) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+static void put_u32(std::vector<unsigned char>& out, unsigned int v)
+{
+	out.push_back((v >> 24) & 0xff);
+	out.push_back((v >> 16) & 0xff);
+	out.push_back((v >> 8) & 0xff);
+	out.push_back(v & 0xff);
+}
+
+static void put_chunk(FILE* file, const char* type, const std::vector<unsigned char>& data)
+{
+	std::vector<unsigned char> head;
+	put_u32(head, (unsigned int)data.size());
+	head.insert(head.end(), type, type + 4);
+	fwrite(&head[0], 1, head.size(), file);
+	if (!data.empty())
+		fwrite(&data[0], 1, data.size(), file);
+
+	unsigned int crc = update_crc(0xffffffffu, (const unsigned char*)type, 4);
+	if (!data.empty())
+		crc = update_crc(crc, &data[0], data.size());
+	std::vector<unsigned char> tail;
+	put_u32(tail, crc ^ 0xffffffffu);
+	fwrite(&tail[0], 1, tail.size(), file);
+}
+
+bool write_png(const char* filename, int width, int height, const unsigned char* rgb)
+{
+	if (!crc_table_ready)
+		make_crc_table();
+
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Could not open %s for writing.\n", filename);
+		return false;
+	}
+
+	static const unsigned char signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+	fwrite(signature, 1, 8, file);
+
+	std::vector<unsigned char> header;
+	put_u32(header, width);
+	put_u32(header, height);
+	header.push_back(8);	// bit depth
+	header.push_back(2);	// color type RGB
+	header.push_back(0);	// deflate
+	header.push_back(0);	// adaptive filtering
+	header.push_back(0);	// no interlace
+	put_chunk(file, "IHDR", header);
+
+	// scanlines with filter type 0 in front of each row
+	size_t row = (size_t)width * 3;
+	std::vector<unsigned char> raw((row + 1) * height);
+	for (int j = 0; j < height; j++) {
+		raw[j * (row + 1)] = 0;
+		memcpy(&raw[j * (row + 1) + 1], rgb + j * row, row);
+	}
+
+	std::vector<unsigned char> zdata;
+	zdata.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zdata.push_back(0x78);
+	zdata.push_back(0x01);
+	unsigned int a = 1, b = 0;
+	size_t pos = 0;
+	do {
+		size_t len = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+		zdata.push_back(pos + len == raw.size() ? 1 : 0);
+		zdata.push_back(len & 0xff);
+		zdata.push_back((len >> 8) & 0xff);
+		zdata.push_back(~len & 0xff);
+		zdata.push_back((~len >> 8) & 0xff);
+		for (size_t k = 0; k < len; k++) {
+			a = (a + raw[pos + k]) % 65521;
+			b = (b + a) % 65521;
+		}
+		zdata.insert(zdata.end(), raw.begin() + pos, raw.begin() + pos + len);
+		pos += len;
+	} while (pos < raw.size());
+	put_u32(zdata, (b << 16) | a);
+	put_chunk(file, "IDAT", zdata);
+
+	put_chunk(file, "IEND", std::vector<unsigned char>());
+
+	bool ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+bool write_image(const char* filename, int width, int height, const unsigned char* rgb)
+{
+	size_t n = strlen(filename);
+	if (n > 4 && (strcmp(filename + n - 4, ".png") == 0 || strcmp(filename + n - 4, ".PNG") == 0))
+		return write_png(filename, width, height, rgb);
+	return write_ppm(filename, width, height, rgb);
+}
@@ -0,0 +1,22 @@
+/*
+
+Writing images to disk
+
+*/
+
+#pragma once
+
+// writes a binary PPM (P6) file
+// rgb: width*height*3 bytes, rows from top to bottom
+// returns false if the file could not be written
+bool write_ppm(const char* filename, int width, int height, const unsigned char* rgb);
+
+// writes a binary PGM (P5) file from width*height gray bytes
+bool write_pgm(const char* filename, int width, int height, const unsigned char* gray);
+
+// writes an 8 bit RGB PNG file; the image data is stored without
+// compression, which keeps the encoder small and fast
+bool write_png(const char* filename, int width, int height, const unsigned char* rgb);
+
+// writes a PNG if the file name ends in .png, a PPM otherwise
+bool write_image(const char* filename, int width, int height, const unsigned char* rgb);
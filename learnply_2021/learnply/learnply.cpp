@@ -5,6 +5,9 @@
 #include <fstream>
 #include <vector>
 #include <queue>
+#include <chrono>
+#include <string>
+#include <algorithm>
 
 #include "glError.h"
 #include "gl/glew.h"
@@ -17,21 +20,44 @@
 #include "tmatrix.h"
 
 #include "drawUtil.h"
-
-Polyhedron* poly;
+#include "renderBatch.h"
+#include "cellIndex.h"
+#include "pick.h"
+#include "fieldSampler.h"
+#include "lic.h"
+#include "imageIO.h"
+#include "raster.h"
+#include "frameWriter.h"
+#include "streamlineSet.h"
+#include "fieldContext.h"
+#include "placementSweep.h"
+#include "bench.h"
+#include "skeleton.h"
+#include "progressivePlacement.h"
+#include "viewportPlacement.h"
+#include "streamlineHierarchy.h"
+
+FieldContext* field; // the field shown in the window: mesh, lookup structures and streamline engine
+Polyhedron* poly; // field->poly
 std::vector<PolyLine> lines;
 std::vector<icVector3> init_points; // saveing one point for one streamline, we use this to generate lines for a streamline, and save streamlines into streamlines variable.
 //std::vector<icVector3> sources;
 //std::vector<icVector3> saddles;
 //std::vector<icVector3> higher_order;
 std::vector<icVector3> points;
-std::vector<icVector2> tracing_points;
 
-std::vector<icVector2> current_streamline_points; // used for storing points in a single streamline, to calculate other sample points
-std::vector<icVector2> all_steamline_points;	// used for storing all points of existing streamlines except the current streamline, we will add current streamline when we finished using it.
-std::vector<PolyLine> streamlines; // for drawing
-std::vector<PolyLine> tracing_lines;
-std::queue<std::vector<icVector2>> queue; // queue to save valid streamlines
+StreamlineRenderBuffer streamline_buffer; // packed copy of field->engine->streamlines, grows while placement runs
+StreamlineRenderBuffer tracing_buffer; // packed copy of field->engine->tracing_lines
+DotRenderBatch tracing_dots; // packed copy of field->engine->tracing_points and other_seeds
+ProgressivePlacement placer; // places the streamlines of display mode 6 on a worker thread
+ViewportPlacement* viewport_placer; // places the streamlines of display mode 6 for the visible part of the mesh, 'v' toggles
+bool viewport_mode = false;
+double viewport_rect[4]; // visible rectangle the streamline buffer was filled for
+StreamlineHierarchy hierarchy; // nested streamline levels of display mode 6, 'h' toggles, the zoom picks the level
+PlacementParams hierarchy_params; // parameters the hierarchy was built with
+std::vector<int> hierarchy_strips; // strips of streamline_buffer drawn for each level
+bool hierarchy_mode = false;
+DotRenderBatch point_dots; // packed copy of points
 
 
 /*scene related variables*/
@@ -69,19 +95,30 @@ float tmax = win_width / (SCALE * NPN);
 float dmax = SCALE / win_width;
 unsigned char* pixels;
 
-const double STEP = 0.1; // You should experiment to find the optimal step size.
-const int STEP_MAX = 1000; // Upper limit of steps to take for tracing each streamline.
-const float d_sep = 0.8;
-const float d_test = d_sep * 0.5;
-const float initial_x = 0;
-const float initial_y = 0;
-bool traceOn = true;
+PlacementParams placement_params; // step size, separating distance and initial seed of display mode 6, '+' and '-' change d_sep
 /******************************************************************************
 Forward declaration of functions
 ******************************************************************************/
 
 void init(void);
 void initIBFV();
+bool load_mesh(const char* filename);
+void unload_mesh();
+
+/*display mode preparation, shared by the window and offscreen rendering*/
+void set_checkerboard_colors();
+void run_placement();
+void show_placement();
+void edit_field(int quad, double radius);
+void start_placement();
+void update_viewport_placement(bool force);
+void show_hierarchy();
+void poll_placement();
+void finish_placement();
+
+/*offscreen rendering*/
+void render_offscreen(SoftRaster& raster, int mode, const PickView& view, int tile_size);
+int render_offscreen_batch(const std::vector<const char*>& files, const char* out_dir, int mode, int width, int height, int tile_size, const char* ext);
 
 /*glut attaching functions*/
 void keyboard(unsigned char key, int x, int y);
@@ -93,8 +130,7 @@ void mousewheel(int wheel, int direction, int x, int y);
 void reshape(int width, int height);
 
 /*functions for element picking*/
-void display_vertices(GLenum mode, Polyhedron* poly);
-void display_quads(GLenum mode, Polyhedron* poly);
+PickView current_pick_view();
 void display_selected_vertex(Polyhedron* poly);
 void display_selected_quad(Polyhedron* poly);
 
@@ -105,15 +141,10 @@ void clear_sing_points();
 double find_point_x_in_quad(Quad* temp, double x, double y);
 double find_point_y_in_quad(Quad* temp, double x, double y);
 
-double sing_prox(icVector2 pos);
-Quad* streamline_step(icVector2& cpos, icVector2& npos, Quad* cquad, bool forward);
-Vertex* find_vertex(double xx, double yy);
-std::vector<icVector2> build_streamline(const double x, const double y);
-icVector2 select_candidate_seed_point_clockwise(const float x, const float y, const float vx, const float vy);
-icVector2 select_candidate_seed_point_counterclockwise(const float x, const float y, const float vx, const float vy);
-void evenly_spaced_algorithm();
-bool is_seed_point_valid(const icVector2 point, const float min_d);
-icVector2 calculate_vector(icVector2 point);
+/*placement parameter sweeps*/
+int run_placement_sweep(const char* filename, int nthreads);
+int run_hierarchy(const char* filename, int nlevels, const char* out_dir);
+int run_skeleton(const std::vector<const char*>& files, int nthreads, const char* out_dir);
 
 /******************************************************************************
 Main program.
@@ -121,15 +152,120 @@ Main program.
 
 int main(int argc, char* argv[])
 {
-	/*load mesh from ply file*/
-	FILE* this_file = fopen("../data/vector_data/v1.ply", "r");
-	poly = new Polyhedron(this_file);
-	fclose(this_file);
-	
-	/*initialize the mesh*/
-	poly->initialize(); // initialize the mesh
-	poly->write_info();
+	/*parse the command line*/
+	std::vector<const char*> files;
+	const char* out_dir = NULL;
+	int out_mode = 1;
+	int out_width = 1024, out_height = 1024;
+	int tile_size = 1024;
+	const char* out_ext = "png";
+	bool sweep = false;
+	bool place = false;
+	bool skeleton = false;
+	bool trace_bench = false;
+	bool float_report = false;
+	int resample = 0;
+	bool cell_cache = false;
+	int nthreads = 0;
+	int nlevels = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			out_dir = argv[++i];
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+			out_mode = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			sscanf(argv[++i], "%dx%d", &out_width, &out_height);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			tile_size = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			out_ext = argv[++i];
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			placement_params.d_sep = atof(argv[++i]);
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			placement_params.time_budget = atof(argv[++i]);
+		else if (strcmp(argv[i], "-sweep") == 0)
+			sweep = true;
+		else if (strcmp(argv[i], "-place") == 0)
+			place = true;
+		else if (strcmp(argv[i], "-skeleton") == 0)
+			skeleton = true;
+		else if (strcmp(argv[i], "-tracebench") == 0)
+			trace_bench = true;
+		else if (strcmp(argv[i], "-floatreport") == 0)
+			float_report = true;
+		else if (strcmp(argv[i], "-resample") == 0 && i + 1 < argc)
+			resample = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-cellcache") == 0)
+			cell_cache = true;
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			nthreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-levels") == 0 && i + 1 < argc)
+			nlevels = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-longest") == 0)
+			placement_params.order = SEED_LONGEST_FIRST;
+		else if (strcmp(argv[i], "-farthest") == 0)
+			placement_params.order = SEED_FARTHEST_POINT;
+		else if (strcmp(argv[i], "-topology") == 0)
+			placement_params.topology_seeds = true;
+		else if (strcmp(argv[i], "-cellwalk") == 0)
+			placement_params.cell_walk = true;
+		else if (strcmp(argv[i], "-spacing") == 0 && i + 1 < argc)
+			placement_params.seed_spacing = atof(argv[++i]);
+		else if (strcmp(argv[i], "-noearly") == 0) {
+			// trace every streamline to its full length, for comparing step counts
+			placement_params.stop_loops = false;
+			placement_params.min_speed = 0;
+			placement_params.stall_window = 0;
+		}
+		else if (argv[i][0] != '-')
+			files.push_back(argv[i]);
+	}
+	if (files.empty())
+		files.push_back("../data/vector_data/v1.ply");
+
+	/*placement parameter sweep: learnply -sweep [-j threads] file.ply*/
+	if (sweep)
+		return run_placement_sweep(files[0], nthreads);
+
+	/*multi-resolution streamlines: learnply -levels n [-d d_sep] [-o dir] file.ply*/
+	if (nlevels > 0)
+		return run_hierarchy(files[0], nlevels, out_dir);
+
+	/*topological skeletons: learnply -skeleton [-j threads] [-o dir] file.ply ...*/
+	if (skeleton)
+		return run_skeleton(files, nthreads, out_dir);
+
+	/*specialized against generic streamline tracing: learnply -tracebench file.ply ...*/
+	if (trace_bench)
+		return run_trace_bench(files);
+
+	/*streamline endpoints on the float copy of the field against double: learnply -floatreport file.ply ...*/
+	if (float_report)
+		return run_float_report(files);
+
+	/*regular-grid copies of the field: learnply -resample n [-j threads] file.ply ...*/
+	if (resample > 0)
+		return run_resample(files, resample, nthreads);
+
+	/*work with and without the per-quad derivative cache: learnply -cellcache file.ply ...*/
+	if (cell_cache)
+		return run_cell_cache(files, placement_params);
+
+	/*streamlines on many fields at once: learnply -place [-j threads] [-d d_sep] [-spacing f] [-longest | -farthest] [-topology] [-cellwalk] [-noearly] [-o dir] file.ply ...*/
+	if (place) {
+		std::vector<SweepResult> results;
+		place_fields(files, placement_params, nthreads, out_dir, results);
+		print_sweep(results);
+		return 0;
+	}
 
+	/*render without a window: learnply -o dir [-m mode] [-s WxH] [-t tile] [-f png|ppm] file.ply ...*/
+	if (out_dir != NULL)
+		return render_offscreen_batch(files, out_dir, out_mode, out_width, out_height, tile_size, out_ext);
+
+	/*load mesh from ply file*/
+	if (!load_mesh(files[0]))
+		return 1;
 
 	/*init glut and create window*/
 	glutInit(&argc, argv);
@@ -156,12 +292,39 @@ int main(int argc, char* argv[])
 	glutMainLoop();
 
 	/*clear memory before exit*/
-	poly->finalize();	// finalize everything
 	free(pixels);
-	clear_sing_points();
+	unload_mesh();
 	return 0;
 }
 
+/******************************************************************************
+Load a mesh and build its lookup structures
+******************************************************************************/
+
+bool load_mesh(const char* filename)
+{
+	field = FieldContext::load(filename);
+	if (field == NULL)
+		return false;
+	poly = field->poly;
+	poly->write_info();
+	viewport_placer = new ViewportPlacement(field->sampler);
+	return true;
+}
+
+void unload_mesh()
+{
+	placer.cancel();
+	placer.wait();
+	delete viewport_placer;
+	viewport_placer = NULL;
+	hierarchy.clear();
+	hierarchy_mode = false;
+	delete field;
+	field = NULL;
+	poly = NULL;
+}
+
 /******************************************************************************
 Set projection mode
 ******************************************************************************/
@@ -248,6 +411,9 @@ void init(void) {
 
 	mat_ident(rotmat);
 
+	/* load the GL entry points for vertex buffers, falls back to client arrays on failure */
+	glewInit();
+
 	/* select clearing color */
 	glClearColor(0.0, 0.0, 0.0, 0.0);  // background
 	glShadeModel(GL_FLAT);
@@ -265,12 +431,6 @@ void init(void) {
 		glFrontFace(GL_CW);
 	else
 		glFrontFace(GL_CCW);
-
-	for (int i = 0; i < poly->nquads; i++)
-	{
-		Quad* quad = poly->qlist[i];
-		quad->singularity = NULL;
-	}
 }
 
 /******************************************************************************
@@ -311,91 +471,22 @@ void initIBFV()
 }
 
 /******************************************************************************
-Pick objects from the scene
-******************************************************************************/
-
-int processHits(GLint hits, GLuint buffer[])
-{
-	unsigned int i, j;
-	GLuint names, * ptr;
-	double smallest_depth = 1.0e+20, current_depth;
-	int seed_id = -1;
-	unsigned char need_to_update;
-
-	ptr = (GLuint*)buffer;
-	for (i = 0; i < hits; i++) {  /* for each hit  */
-		need_to_update = 0;
-		names = *ptr;
-		ptr++;
-
-		current_depth = (double)*ptr / 0x7fffffff;
-		if (current_depth < smallest_depth) {
-			smallest_depth = current_depth;
-			need_to_update = 1;
-		}
-		ptr++;
-		current_depth = (double)*ptr / 0x7fffffff;
-		if (current_depth < smallest_depth) {
-			smallest_depth = current_depth;
-			need_to_update = 1;
-		}
-		ptr++;
-		for (j = 0; j < names; j++) {  /* for each name */
-			if (need_to_update == 1)
-				seed_id = *ptr - 1;
-			ptr++;
-		}
-	}
-	return seed_id;
-}
-
-/******************************************************************************
-Diaplay all quads for selection
-******************************************************************************/
-
-void display_quads(GLenum mode, Polyhedron* this_poly)
-{
-	unsigned int i, j;
-	GLfloat mat_diffuse[4];
-
-	glEnable(GL_POLYGON_OFFSET_FILL);
-	glPolygonOffset(1., 1.);
-	glEnable(GL_DEPTH_TEST);
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glShadeModel(GL_SMOOTH);
-	glDisable(GL_LIGHTING);
-
-	for (i = 0; i < this_poly->nquads; i++) {
-		if (mode == GL_SELECT)
-			glLoadName(i + 1);
-
-		Quad* temp_q = this_poly->qlist[i];
-		
-		glBegin(GL_POLYGON);
-		for (j = 0; j < 4; j++) {
-			Vertex* temp_v = temp_q->verts[j];
-			glVertex3d(temp_v->x, temp_v->y, temp_v->z);
-		}
-		glEnd();
-	}
-}
-
-/******************************************************************************
-Diaplay all vertices for selection
+Collect the view transform for picking
 ******************************************************************************/
 
-void display_vertices(GLenum mode, Polyhedron* this_poly)
+PickView current_pick_view()
 {
-	for (int i = 0; i < this_poly->nverts; i++) {
-		if (mode == GL_SELECT)
-			glLoadName(i + 1);
-
-		CHECK_GL_ERROR();
-
-		Vertex* temp_v = this_poly->vlist[i];
-		drawDot(temp_v->x, temp_v->y, temp_v->z, 0.15);
-	}
-	CHECK_GL_ERROR();
+	PickView view;
+	view.win_width = win_width;
+	view.win_height = win_height;
+	view.zoom = zoom;
+	view.translation[0] = translation[0];
+	view.translation[1] = translation[1];
+	view.radius_factor = radius_factor;
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			view.rotmat[i][j] = rotmat[i][j];
+	return view;
 }
 
 /******************************************************************************
@@ -456,6 +547,7 @@ void keyboard(unsigned char key, int x, int y) {
 	// clear out lines and points
 	lines.clear();
 	points.clear();
+	point_dots.clear();
 
 	switch (key) {
 	case 27:	// set excape key to exit program
@@ -476,19 +568,7 @@ void keyboard(unsigned char key, int x, int y) {
 	case '3':	// checkerboard display
 	{
 		display_mode = 3;
-
-		double L = (poly->radius * 2) / 30;
-		for (int i = 0; i < poly->nquads; i++) {
-			Quad* temp_q = poly->qlist[i];
-			for (int j = 0; j < 4; j++) {
-
-				Vertex* temp_v = temp_q->verts[j];
-
-				temp_v->R = int(temp_v->x / L) % 2 == 0 ? 1 : 0;
-				temp_v->G = int(temp_v->y / L) % 2 == 0 ? 1 : 0;
-				temp_v->B = 0.0;
-			}
-		}
+		set_checkerboard_colors();
 		glutPostRedisplay();
 	}
 	break;
@@ -496,6 +576,8 @@ void keyboard(unsigned char key, int x, int y) {
 	case '4':	// Drawing points and lines created by the dots_and_lines_example() function
 		display_mode = 4;
 		dots_and_lines_example(&points, &lines);
+		for (int k = 0; k < points.size(); k++)
+			point_dots.add_dot(points[k].x, points[k].y, points[k].z);
 		glutPostRedisplay();
 		break;
 
@@ -515,13 +597,162 @@ void keyboard(unsigned char key, int x, int y) {
 		//higher_order.clear();
 		//sources.clear();
 		//find_singularities();
-		streamlines.clear();
-		evenly_spaced_algorithm();
+		if (hierarchy_mode)
+			show_hierarchy();
+		else if (viewport_mode)
+			update_viewport_placement(true);
+		else
+			start_placement();
+
+		glutPostRedisplay();
+	}
+	break;
 
+	case 'c':	// stop placing streamlines, keeping the ones placed so far
+		placer.cancel();
+		break;
+
+	case 'e':	// export the placed streamlines
+		finish_placement();
+		if (field->engine->streamlines.write("streamlines.txt"))
+			printf("%d streamlines written to streamlines.txt\n", field->engine->streamlines.nlines());
+		break;
+
+	case '+':	// denser streamlines
+	case '-':	// sparser streamlines
+		placement_params.d_sep *= key == '+' ? 1.0 / 1.25 : 1.25;
+		if (display_mode == 6 && !hierarchy_mode) {
+			if (viewport_mode)
+				update_viewport_placement(true);
+			else
+				start_placement();
+			glutPostRedisplay();
+		}
+		else
+			printf("d_sep %g\n", placement_params.d_sep);
+		break;
+
+	case 't':	// seed templates around the singularities first, or not
+		placement_params.topology_seeds = !placement_params.topology_seeds;
+		printf("topology seeding %s\n", placement_params.topology_seeds ? "on" : "off");
+		if (display_mode == 6 && !hierarchy_mode) {
+			if (viewport_mode)
+				update_viewport_placement(true);
+			else
+				start_placement();
+			glutPostRedisplay();
+		}
+		break;
+
+	case 'k':	// next seeding strategy: neighbour seeding, longest streamline first, farthest point
+	{
+		const char* names[] = { "neighbour seeding", "longest streamline first", "farthest point" };
+		placement_params.order = (SeedOrder)((placement_params.order + 1) % 3);
+		printf("seeding: %s\n", names[placement_params.order]);
+		if (display_mode == 6 && !hierarchy_mode) {
+			if (viewport_mode)
+				update_viewport_placement(true);
+			else
+				start_placement();
+			glutPostRedisplay();
+		}
+	}
+	break;
+
+	case 'v':	// place streamlines only for the visible part of the mesh
+		viewport_mode = !viewport_mode;
+		hierarchy_mode = false;
+		printf("viewport placement %s\n", viewport_mode ? "on" : "off");
+		if (display_mode == 6) {
+			if (viewport_mode) {
+				placer.cancel();
+				placer.wait();
+				update_viewport_placement(true);
+			}
+			else
+				start_placement();
+			glutPostRedisplay();
+		}
+		break;
+
+	case 'h':	// nested streamline levels, denser as the view zooms in
+	case 'H':	// the same, read from hierarchy.txt
+		hierarchy_mode = key == 'H' || !hierarchy_mode;
+		viewport_mode = false;
+		placer.cancel();
+		placer.wait();
+		if (key == 'H') {
+			if (hierarchy.read("hierarchy.txt")) {
+				printf("%d levels read from hierarchy.txt\n", hierarchy.nlevels());
+				// the file only keeps the spacing of each level
+				hierarchy_params = placement_params;
+				hierarchy_params.d_sep = hierarchy.d_seps[0];
+			}
+		}
+		else if (hierarchy_mode && (hierarchy.nlevels() == 0 || !hierarchy_params.same_placement(placement_params))) {
+			auto start = std::chrono::steady_clock::now();
+			hierarchy.build(*field->engine, placement_params, 4);
+			hierarchy_params = placement_params;
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			printf("placed %d levels, %d streamlines in %.1f ms\n", hierarchy.nlevels(), hierarchy.lines.nlines(), ms);
+			if (hierarchy.write("hierarchy.txt"))
+				printf("written to hierarchy.txt\n");
+		}
+		if (display_mode == 6) {
+			if (hierarchy_mode)
+				show_hierarchy();
+			else
+				start_placement();
+			glutPostRedisplay();
+		}
+		break;
+
+	case 'w':	// turn the field a quarter turn around the selected quad and place the streamlines there again
+	{
+		if (poly->selected_quad < 0) {
+			printf("select a quad first (shift + left click)\n");
+			break;
+		}
+		// the field cannot change under the worker: a run in progress is
+		// stopped and started again on the edited field. The streamlines
+		// still queued by the placer are taken before the buffers are re-packed
+		bool placing = placer.running();
+		placer.cancel();
+		placer.wait();
+		poll_placement();
+		edit_field(poly->selected_quad, 3 * placement_params.d_sep);
+		if (placing)
+			start_placement();
 		glutPostRedisplay();
 	}
 	break;
 
+	case 'l':	// write a line integral convolution image of the field
+	{
+		LICParams params;
+		params.width = win_width;
+		params.height = win_height;
+		std::vector<unsigned char> image;
+
+		auto start = std::chrono::steady_clock::now();
+		compute_lic(*field->sampler, params, image);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (write_pgm("lic.pgm", params.width, params.height, &image[0]))
+			printf("LIC image %dx%d written to lic.pgm in %.2f s\n", params.width, params.height, seconds);
+	}
+	break;
+
+	case 'o':	// render the current display mode offscreen at 4x the window size
+	{
+		finish_placement();
+		SoftRaster raster(win_width * 4, win_height * 4);
+		render_offscreen(raster, display_mode, current_pick_view(), 1024);
+		if (write_png("frame.png", raster.width, raster.height, &raster.image[0]))
+			printf("frame %dx%d written to frame.png\n", raster.width, raster.height);
+	}
+	break;
+
 	case 'r':	// reset rotation and transformation
 		mat_ident(rotmat);
 		translation[0] = 0;
@@ -532,6 +763,186 @@ void keyboard(unsigned char key, int x, int y) {
 	}
 }
 
+/******************************************************************************
+Prepare the data shown by display modes 3 and 6
+******************************************************************************/
+
+void set_checkerboard_colors()
+{
+	double L = (poly->radius * 2) / 30;
+	for (int i = 0; i < poly->nquads; i++) {
+		Quad* temp_q = poly->qlist[i];
+		for (int j = 0; j < 4; j++) {
+
+			Vertex* temp_v = temp_q->verts[j];
+
+			temp_v->R = int(temp_v->x / L) % 2 == 0 ? 1 : 0;
+			temp_v->G = int(temp_v->y / L) % 2 == 0 ? 1 : 0;
+			temp_v->B = 0.0;
+		}
+	}
+}
+
+void run_placement()
+{
+	field->engine->run(placement_params);
+	const StreamlineSet& streamlines = field->engine->streamlines;
+	printf("placed %d streamlines, %d points, %.1f KB held by the engine (d_sep %g)\n", streamlines.nlines(), streamlines.npoints(),
+		field->engine->memory_bytes() / 1024.0, placement_params.d_sep);
+	show_placement();
+}
+
+// re-packs the streamlines of the engine for drawing
+void show_placement()
+{
+	streamline_buffer.clear();
+	streamline_buffer.add_streamlines(field->engine->streamlines);
+	tracing_buffer.clear();
+	tracing_buffer.add_streamlines(field->engine->tracing_lines);
+	tracing_dots.clear();
+	for (int k = 0; k < field->engine->tracing_points.size(); ++k)
+		tracing_dots.add_dot(field->engine->tracing_points[k].x, field->engine->tracing_points[k].y, 0, 1, 1, 1);
+	for (int k = 0; k < field->engine->other_seeds.size(); ++k)
+		tracing_dots.add_dot(field->engine->other_seeds[k].x, field->engine->other_seeds[k].y, 0, 1, 1, 1);
+}
+
+// starts placing streamlines in the background; the display picks them up
+// with poll_placement as they are finished
+std::chrono::steady_clock::time_point placement_start;
+bool placement_reported = true;
+
+void start_placement()
+{
+	streamline_buffer.clear();
+	tracing_buffer.clear();
+	tracing_dots.clear();
+	placement_start = std::chrono::steady_clock::now();
+	placement_reported = false;
+	placer.start(field->engine, placement_params);
+}
+
+void poll_placement()
+{
+	static StreamlineSet lines, tracing;
+	static std::vector<icVector2> seeds;
+	lines.clear();
+	tracing.clear();
+	seeds.clear();
+	if (placer.poll(lines, tracing, seeds) > 0) {
+		streamline_buffer.add_streamlines(lines);
+		tracing_buffer.add_streamlines(tracing);
+		for (int k = 0; k < seeds.size(); ++k)
+			tracing_dots.add_dot(seeds[k].x, seeds[k].y, 0, 1, 1, 1);
+	}
+
+	if (!placement_reported && placer.finished()) {
+		placer.wait();
+		placement_reported = true;
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - placement_start).count();
+		printf("placed %d streamlines in %.1f ms%s\n", field->engine->streamlines.nlines(), ms,
+			field->engine->complete() ? "" : " (stopped early)");
+	}
+}
+
+// waits for the run in progress to end; its streamlines are polled on the
+// way, since the worker cannot go on while the queue is full
+void finish_placement()
+{
+	while (!placer.finished()) {
+		poll_placement();
+		std::this_thread::yield();
+	}
+	placer.wait();
+}
+
+// refills the streamline buffer with the cached tiles of viewport_placer
+// when the visible rectangle has changed; new tiles are placed on this
+// thread, which only takes a few ms for the handful a pan or zoom uncovers
+void update_viewport_placement(bool force)
+{
+	double rect[4];
+	if (!visible_rect(current_pick_view(), poly, rect))
+		return;
+	if (!force && memcmp(rect, viewport_rect, sizeof(rect)) == 0)
+		return;
+	memcpy(viewport_rect, rect, sizeof(rect));
+
+	static StreamlineSet lines;
+	lines.clear();
+	auto start = std::chrono::steady_clock::now();
+	int ntiles = viewport_placer->place(placement_params, rect, lines);
+	if (ntiles > 0) {
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("placed %d tiles in %.1f ms, %d tiles cached\n", ntiles, ms, viewport_placer->ncached());
+	}
+
+	streamline_buffer.clear();
+	streamline_buffer.add_streamlines(lines);
+	tracing_buffer.clear();
+	tracing_dots.clear();
+}
+
+// packs every level of the hierarchy into the streamline buffer once;
+// switching levels then only changes how many strips are drawn
+void show_hierarchy()
+{
+	streamline_buffer.clear();
+	tracing_buffer.clear();
+	tracing_dots.clear();
+	hierarchy_strips.clear();
+	StreamlineSet level;
+	for (int k = 0; k < hierarchy.nlevels(); k++) {
+		level.clear();
+		for (int l = k > 0 ? hierarchy.level_end[k - 1] : 0; l < hierarchy.level_end[k]; l++)
+			level.add_line(hierarchy.lines, l);
+		streamline_buffer.add_streamlines(level);
+		hierarchy_strips.push_back(streamline_buffer.nstrips());
+	}
+}
+
+// a small field design edit: turns the vectors of the vertices within
+// radius of the center of quad by 90 degrees, then only the streamlines
+// through the changed quads are placed again
+void edit_field(int quad, double radius)
+{
+	const CellIndex* index = field->index;
+	double cx = 0.5 * (index->qx1[quad] + index->qx2[quad]);
+	double cy = 0.5 * (index->qy1[quad] + index->qy2[quad]);
+	std::vector<char> changed(poly->nverts, 0);
+	for (int i = 0; i < poly->nverts; i++) {
+		Vertex* v = poly->vlist[i];
+		if ((v->x - cx) * (v->x - cx) + (v->y - cy) * (v->y - cy) > radius * radius)
+			continue;
+		double vx = v->vx;
+		v->vx = -v->vy;
+		v->vy = vx;
+		changed[i] = 1;
+	}
+
+	std::vector<int> dirty;
+	for (int i = 0; i < poly->nquads; i++)
+		for (int j = 0; j < 4; j++)
+			if (changed[poly->qlist[i]->verts[j]->index]) {
+				dirty.push_back(i);
+				break;
+			}
+
+	auto start = std::chrono::steady_clock::now();
+	field->sampler->update(dirty);
+	int removed = field->engine->update(dirty);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	printf("%d quads edited, %d streamlines replaced, %d in total, %.1f ms\n", (int)dirty.size(), removed,
+		field->engine->streamlines.nlines(), ms);
+
+	// the cached viewport tiles and levels were placed in the old field
+	viewport_placer->clear();
+	hierarchy.clear();
+	hierarchy_mode = false;
+	viewport_mode = false;
+	if (display_mode == 6)
+		show_placement();
+}
+
 /******************************************************************************
 Callback function for dragging mouse
 ******************************************************************************/
@@ -609,82 +1020,18 @@ void mouse(int button, int state, int x, int y) {
 		}
 		else if (state == GLUT_UP) {
 
-			if (button == GLUT_LEFT_BUTTON && key == GLUT_ACTIVE_SHIFT) {  // build up the selection feedback mode
+			if (button == GLUT_LEFT_BUTTON && key == GLUT_ACTIVE_SHIFT) {
 
 				/*select face*/
-
-				GLuint selectBuf[512];
-				GLint hits;
-				GLint viewport[4];
-
-				glGetIntegerv(GL_VIEWPORT, viewport);
-
-				glSelectBuffer(win_width, selectBuf);
-				(void)glRenderMode(GL_SELECT);
-
-				glInitNames();
-				glPushName(0);
-
-				glMatrixMode(GL_PROJECTION);
-				glPushMatrix();
-				glLoadIdentity();
-
-				/*create 5x5 pixel picking region near cursor location */
-				gluPickMatrix((GLdouble)x, (GLdouble)(viewport[3] - y), 1.0, 1.0, viewport);
-
-				set_view(GL_SELECT);
-				set_scene(GL_SELECT, poly);
-				display_quads(GL_SELECT, poly);
-
-				glMatrixMode(GL_PROJECTION);
-				glPopMatrix();
-				glFlush();
-
-				glMatrixMode(GL_MODELVIEW);
-
-				hits = glRenderMode(GL_RENDER);
-				poly->selected_quad = processHits(hits, selectBuf);
+				poly->selected_quad = pick_quad(*field->index, current_pick_view(), x, y);
 				printf("Selected quad id = %d\n", poly->selected_quad);
 				glutPostRedisplay();
 
-				CHECK_GL_ERROR();
-
 			}
 			else if (button == GLUT_LEFT_BUTTON && key == GLUT_ACTIVE_CTRL)
 			{
-				/*select vertex*/
-
-				GLuint selectBuf[512];
-				GLint hits;
-				GLint viewport[4];
-
-				glGetIntegerv(GL_VIEWPORT, viewport);
-
-				glSelectBuffer(win_width, selectBuf);
-				(void)glRenderMode(GL_SELECT);
-
-				glInitNames();
-				glPushName(0);
-
-				glMatrixMode(GL_PROJECTION);
-				glPushMatrix();
-				glLoadIdentity();
-
-				/*  create 5x5 pixel picking region near cursor location */
-				gluPickMatrix((GLdouble)x, (GLdouble)(viewport[3] - y), 1.0, 1.0, viewport);
-
-				set_view(GL_SELECT);
-				set_scene(GL_SELECT, poly);
-				display_vertices(GL_SELECT, poly);
-
-				glMatrixMode(GL_PROJECTION);
-				glPopMatrix();
-				glFlush();
-
-				glMatrixMode(GL_MODELVIEW);
-
-				hits = glRenderMode(GL_RENDER);
-				poly->selected_vertex = processHits(hits, selectBuf);
+				/*select vertex, within the radius of the drawn dots*/
+				poly->selected_vertex = pick_vertex(*field->index, current_pick_view(), x, y, 0.15);
 				printf("Selected vert id = %d\n", poly->selected_vertex);
 
 				if (poly->selected_vertex >= 0) {
@@ -1006,11 +1353,7 @@ void display_polyhedron(Polyhedron* poly)
 		}
 
 		// draw points
-		for (int k = 0; k < points.size(); k++)
-		{
-			icVector3 point = points[k];
-			drawDot(point.x, point.y, point.z);
-		}
+		point_dots.draw();
 		break;
 	}
 	break;
@@ -1025,23 +1368,22 @@ void display_polyhedron(Polyhedron* poly)
 	case 6: // add your own display mode
 	{
 		displayIBFV();
+		if (viewport_mode)
+			update_viewport_placement(false);
+		else if (!hierarchy_mode)
+			poll_placement();
 		
-		drawDot(initial_x, initial_y, 0);
-		for (int k = 0; k < streamlines.size(); ++k)
-		{
-			drawPolyLine(streamlines[k], 1.0, 1.0, 0.0, 0.0);
-		}
+		drawDot(placement_params.seed_x, placement_params.seed_y, 0);
+		if (hierarchy_mode && hierarchy.nlevels() > 0)
+			// keep the spacing on screen about that of d_sep at zoom 1
+			streamline_buffer.draw(1.0, 1.0, 0.0, 0.0, hierarchy_strips[hierarchy.level_for(placement_params.d_sep * zoom)]);
+		else
+			streamline_buffer.draw(1.0, 1.0, 0.0, 0.0);
 
-		if (traceOn) {
-			for (int k = 0; k < tracing_lines.size(); ++k)
-			{
-				drawPolyLine(tracing_lines[k], 1.0, 1.0, 1.0, 0.0);
-			}
+		if (placement_params.trace) {
+			tracing_buffer.draw(1.0, 1.0, 1.0, 0.0);
 
-			for (int k = 0; k < tracing_points.size(); ++k)
-			{
-				drawDot(tracing_points[k].x, tracing_points[k].y, 0, 0.15, 1, 1, 1);
-			}
+			tracing_dots.draw();
 		}
 
 		glutPostRedisplay();
@@ -1057,6 +1399,197 @@ void display_polyhedron(Polyhedron* poly)
 }
 
 
+/******************************************************************************
+Offscreen rendering of the display modes with the CPU rasterizer. Mirrors
+display_polyhedron; IBFV (modes 5 and 6) is replaced by a LIC image since
+it needs a GL context and many frames to converge.
+******************************************************************************/
+
+struct LICTexture
+{
+	int width, height;
+	std::vector<unsigned char> gray;
+};
+
+static void lic_shader(double x, double y, float rgb[3], void* user)
+{
+	LICTexture* tex = (LICTexture*)user;
+	int i = (int)((x - field->index->xmin) / (field->index->xmax - field->index->xmin) * tex->width);
+	int j = (int)((field->index->ymax - y) / (field->index->ymax - field->index->ymin) * tex->height);
+	i = i < 0 ? 0 : (i >= tex->width ? tex->width - 1 : i);
+	j = j < 0 ? 0 : (j >= tex->height ? tex->height - 1 : j);
+	rgb[0] = rgb[1] = rgb[2] = tex->gray[j * tex->width + i] / 255.0f;
+}
+
+// approximates the fixed function lighting of mode 1 for a vertex normal
+static void lit_color(const icVector3& n, const PickView& view, float rgb[3])
+{
+	static const float diffuse[3] = { 0.24, 0.4, 0.47 };
+
+	// normal in eye space, lights as set up in set_view
+	double nx = view.rotmat[0][0] * n.x + view.rotmat[1][0] * n.y + view.rotmat[2][0] * n.z;
+	double nz = view.rotmat[0][2] * n.x + view.rotmat[1][2] * n.y + view.rotmat[2][2] * n.z;
+	double light = 0.2 + 0.3 + 0.7 * fmax(0.0, nx) + 0.5 * fmax(0.0, nz);
+	for (int k = 0; k < 3; k++)
+		rgb[k] = (float)fmin(1.0, diffuse[k] * light);
+}
+
+void render_offscreen(SoftRaster& raster, int mode, const PickView& view, int tile_size)
+{
+	raster.set_view(view, poly);
+
+	LICTexture lic;
+	if (mode == 5 || mode == 6) {
+		LICParams params;
+		params.width = raster.width < 2048 ? raster.width : 2048;
+		params.height = raster.height < 2048 ? raster.height : 2048;
+		compute_lic(*field->sampler, params, lic.gray);
+		lic.width = params.width;
+		lic.height = params.height;
+	}
+
+	if (tile_size < 1)
+		tile_size = 1024;
+	for (int y0 = 0; y0 < raster.height; y0 += tile_size)
+		for (int x0 = 0; x0 < raster.width; x0 += tile_size)
+		{
+			int tw = raster.width - x0 < tile_size ? raster.width - x0 : tile_size;
+			int th = raster.height - y0 < tile_size ? raster.height - y0 : tile_size;
+			raster.begin_tile(x0, y0, tw, th, 1.0, 1.0, 1.0);
+
+			switch (mode)
+			{
+			case 1:	// solid color display with lighting
+			case 4:	// points and lines drawing example
+			{
+				for (int i = 0; i < poly->nquads; i++) {
+					Quad* temp_q = poly->qlist[i];
+					float c[4][3];
+					for (int j = 0; j < 4; j++)
+						lit_color(temp_q->verts[j]->normal, view, c[j]);
+					raster.quad(temp_q, c);
+				}
+
+				if (mode == 4) {
+					for (int k = 0; k < lines.size(); k++)
+						raster.polyline(lines[k], 1.0, 0.0, 0.0);
+					for (int k = 0; k < points.size(); k++)
+						raster.dot(points[k].x, points[k].y, points[k].z, 0.15, 0.0, 0.0, 0.0);
+				}
+			}
+			break;
+
+			case 2:	// wireframe display
+			{
+				for (int i = 0; i < poly->nquads; i++) {
+					Quad* temp_q = poly->qlist[i];
+					for (int j = 0; j < 4; j++) {
+						Vertex* a = temp_q->verts[j];
+						Vertex* b = temp_q->verts[(j + 1) % 4];
+						raster.line(icVector3(a->x, a->y, a->z), icVector3(b->x, b->y, b->z), 0.0, 0.0, 0.0);
+					}
+				}
+			}
+			break;
+
+			case 3:	// checkerboard pattern display
+			{
+				for (int i = 0; i < poly->nquads; i++) {
+					Quad* temp_q = poly->qlist[i];
+					float c[4][3];
+					for (int j = 0; j < 4; j++) {
+						c[j][0] = temp_q->verts[j]->R;
+						c[j][1] = temp_q->verts[j]->G;
+						c[j][2] = temp_q->verts[j]->B;
+					}
+					raster.quad(temp_q, c);
+				}
+			}
+			break;
+
+			case 5:	// vector field display
+			case 6:	// streamlines over the vector field
+			{
+				for (int i = 0; i < poly->nquads; i++)
+					raster.quad(poly->qlist[i], lic_shader, &lic);
+
+				if (mode == 6) {
+					raster.dot(placement_params.seed_x, placement_params.seed_y, 0, 0.15, 0.0, 0.0, 0.0);
+					raster.streamlines(field->engine->streamlines, 1.0, 0.0, 0.0);
+
+					if (placement_params.trace) {
+						raster.streamlines(field->engine->tracing_lines, 1.0, 1.0, 0.0);
+						for (int k = 0; k < field->engine->tracing_points.size(); ++k)
+							raster.dot(field->engine->tracing_points[k].x, field->engine->tracing_points[k].y, 0, 0.15, 1.0, 1.0, 1.0);
+						for (int k = 0; k < field->engine->other_seeds.size(); ++k)
+							raster.dot(field->engine->other_seeds[k].x, field->engine->other_seeds[k].y, 0, 0.15, 1.0, 1.0, 1.0);
+					}
+				}
+			}
+			break;
+
+			default:
+			{
+				// don't draw anything
+			}
+			}
+
+			raster.end_tile();
+		}
+}
+
+/******************************************************************************
+Render one image per mesh file without opening a window. Frames are
+encoded and written by a FrameWriter thread while the next mesh is loaded
+and rendered.
+******************************************************************************/
+
+int render_offscreen_batch(const std::vector<const char*>& files, const char* out_dir, int mode, int width, int height, int tile_size, const char* ext)
+{
+	PickView view;
+	view.win_width = width;
+	view.win_height = height;
+	view.zoom = 1.0;
+	view.translation[0] = view.translation[1] = 0;
+	view.radius_factor = radius_factor;
+	mat_ident(view.rotmat);
+
+	FrameWriter writer;
+	for (int f = 0; f < files.size(); f++) {
+		if (!load_mesh(files[f]))
+			continue;
+
+		lines.clear();
+		points.clear();
+		if (mode == 3)
+			set_checkerboard_colors();
+		else if (mode == 4)
+			dots_and_lines_example(&points, &lines);
+		else if (mode == 6)
+			run_placement();
+
+		SoftRaster raster(width, height);
+		render_offscreen(raster, mode, view, tile_size);
+
+		// <out_dir>/<mesh name>_m<mode>.<ext>
+		std::string name = files[f];
+		size_t slash = name.find_last_of("/\\");
+		if (slash != std::string::npos)
+			name = name.substr(slash + 1);
+		size_t dot = name.rfind('.');
+		if (dot != std::string::npos)
+			name = name.substr(0, dot);
+		char suffix[32];
+		sprintf(suffix, "_m%d.", mode);
+		writer.submit(std::string(out_dir) + "/" + name + suffix + ext, width, height, raster.image);
+
+		unload_mesh();
+	}
+	writer.finish();
+	return writer.nfailed() == 0 ? 0 : 1;
+}
+
+
 void find_singularities()
 {
 	// 1. Delete any old singularity points
@@ -1149,10 +1682,10 @@ void find_singularities()
 
 		// classify types of singularity
 		// 10. calculate the jacobian values dfdx, dfdy, dgdx, dgdy
-		double dfdx = (-(y2 - sing_y) * fx1y1 + (y2 - sing_y) * fx2y1 - (sing_y - y1) * fx1y2 + (sing_y - y1) * fx2y2) / (x2 - x1) * (y2 - y1);
-		double dfdy = (-(x2 - sing_x) * fx1y1 - (sing_x - x1) * fx2y1 + (x2 - sing_x) * fx1y2 + (sing_x - x1) * fx2y2) / (x2 - x1) * (y2 - y1);
-		double dgdx = (-(y2 - sing_y) * gx1y1 + (y2 - sing_y) * gx2y1 - (sing_y - y1) * gx1y2 + (sing_y - y1) * gx2y2) / (x2 - x1) * (y2 - y1);
-		double dgdy = (-(x2 - sing_x) * gx1y1 - (sing_x - x1) * gx2y1 + (x2 - sing_x) * gx1y2 + (sing_x - x1) * gx2y2) / (x2 - x1) * (y2 - y1);
+		double dfdx = (-(y2 - sing_y) * fx1y1 + (y2 - sing_y) * fx2y1 - (sing_y - y1) * fx1y2 + (sing_y - y1) * fx2y2) / ((x2 - x1) * (y2 - y1));
+		double dfdy = (-(x2 - sing_x) * fx1y1 - (sing_x - x1) * fx2y1 + (x2 - sing_x) * fx1y2 + (sing_x - x1) * fx2y2) / ((x2 - x1) * (y2 - y1));
+		double dgdx = (-(y2 - sing_y) * gx1y1 + (y2 - sing_y) * gx2y1 - (sing_y - y1) * gx1y2 + (sing_y - y1) * gx2y2) / ((x2 - x1) * (y2 - y1));
+		double dgdy = (-(x2 - sing_x) * gx1y1 - (sing_x - x1) * gx2y1 + (x2 - sing_x) * gx1y2 + (sing_x - x1) * gx2y2) / ((x2 - x1) * (y2 - y1));
 		icMatrix2x2 m = icMatrix2x2(dfdx, dfdy, dgdx, dgdy);
 		double determ = determinant(m);
 		//if (determ > 0)
@@ -1195,362 +1728,95 @@ void clear_sing_points() {
 	return;
 }
 
-double sing_prox(icVector2 pos)
-{
-	double prox = DBL_MAX;
-	for (int i = 0; i < poly->nquads; i++)
-	{
-		Quad* quad = poly->qlist[i];
-		if (quad->singularity == NULL) continue;
-		icVector2 spos = *(quad->singularity);
-		// get the (x,y) coordinates of the
-		// singularity in an icVector2 object.
-		double dist = length(pos - spos);
-		if (dist < prox)
-			prox = dist;
-	}
-	return prox;
-}
+/******************************************************************************
+Run a grid of placement parameters over one mesh and print a line per run
+******************************************************************************/
 
-Quad* streamline_step(icVector2& cpos, icVector2& npos, Quad* cquad, bool forward)
+int run_placement_sweep(const char* filename, int nthreads)
 {
-	double x1, y1, x2, y2, f11, f12, f21, f22, g11, g21, g12, g22;
-	Vertex* v11, * v12, * v21, * v22;
-
-	x1 = poly->smallest_x(cquad);
-	x2 = poly->largest_x(cquad);
-	y1 = poly->smallest_y(cquad);
-	y2 = poly->largest_y(cquad);
-
-	v11 = find_vertex(x1, y1);
-	f11 = v11->vx;
-	g11 = v11->vy;
-
-	v12 = find_vertex(x1, y2);
-	f12 = v12->vx;
-	g12 = v12->vy;
-
-	v21 = find_vertex(x2, y1);
-	f21 = v21->vx;
-	g21 = v21->vy;
-
-	v22 = find_vertex(x2, y2);
-	f22 = v22->vx;
-	g22 = v22->vy;
-
-	double x0 = cpos.x;
-	double y0 = cpos.y;
-	icVector2 vect;
-	double m1 = (x2 - x0) * (y2 - y0) / (x2 - x1) / (y2 - y1);
-	double m2 = (x0 - x1) * (y2 - y0) / (x2 - x1) / (y2 - y1);
-	double m3 = (x2 - x0) * (y0 - y1) / (x2 - x1) / (y2 - y1);
-	double m4 = (x0 - x1) * (y0 - y1) / (x2 - x1) / (y2 - y1);
-	vect.x = m1 * f11 + m2 * f21 + m3 * f12 + m4 * f22;
-	vect.y = m1 * g11 + m2 * g21 + m3 * g12 + m4 * g22;
-	normalize(vect);
-	if (!forward) { vect *= -1.0; }
-	npos.x = cpos.x + STEP * vect.x;
-	npos.y = cpos.y + STEP * vect.y;
-
-	Quad* nquad = cquad; //guess that the next quad will be the same
-	/*check if npos is outside the current quad*/
-	if (npos.x < x1 || npos.x > x2 || npos.y < y1 || npos.y > y2)
-	{
-		// set up local variables
-		icVector2 cross_x1, cross_y1, cross_x2, cross_y2;
-		double dprod_x1, dprod_y1, dprod_x2, dprod_y2;
-		Edge* cross_edge;
-
-		cross_y1 = icVector2(x0 + ((y1 - y0) / vect.y) * vect.x, y1);
-		cross_y2 = icVector2(x0 + ((y2 - y0) / vect.y) * vect.x, y2);
-		cross_x1 = icVector2(x1, y0 + ((x1 - x0) / vect.x) * vect.y);
-		cross_x2 = icVector2(x2, y0 + ((x2 - x0) / vect.x) * vect.y);
-
-		dprod_y1 = dot(vect, cross_y1 - cpos);
-		dprod_y2 = dot(vect, cross_y2 - cpos);
-		dprod_x1 = dot(vect, cross_x1 - cpos);
-		dprod_x2 = dot(vect, cross_x2 - cpos);
-		// check y1
-		if (cross_y1.x >= x1 && cross_y1.x <= x2 && dprod_y1 > 0 ) {
-			npos = cross_y1;
-			cross_edge = poly->find_edge(v11, v21);
-			nquad = poly->other_quad(cross_edge, cquad);
-		}
-		//check y2
-		else if (cross_y2.x >= x1 && cross_y2.x <= x2 && dprod_y2 > 0) {
-			npos = cross_y2;
-			cross_edge = poly->find_edge(v12, v22);
-			nquad = poly->other_quad(cross_edge, cquad);
-		}
-		//check x1
-		else if (cross_x1.y >= y1 && cross_x1.y <= y2 && dprod_x1 > 0) {
-			npos = cross_x1;
-			cross_edge = poly->find_edge(v11, v12);
-			nquad = poly->other_quad(cross_edge, cquad);
-		}
-		//check x2
-		else if (cross_x2.y >= y1 && cross_x2.y <= y2 && dprod_x2 > 0) {
-			npos = cross_x2;
-			cross_edge = poly->find_edge(v21, v22);
-			nquad = poly->other_quad(cross_edge, cquad);
-		}
-		// none of the crossing points meets the conditions
-		else {
-			nquad = poly->find_quad(npos.x, npos.y);
-		}
-
-		double proximity = sing_prox(npos);
-		if (proximity < STEP) {
-			nquad = NULL;
-		}
-	}
-	return nquad;
-}
+	if (!load_mesh(filename))
+		return 1;
 
-// takes x and y coordinates of a seed point and draws a streamline through that point
-std::vector<icVector2> build_streamline(const double x, const double y)
-{
-	std::vector<icVector2> new_streamline_points;
-	new_streamline_points.clear();
-	{
-		Quad* cquad = poly->find_quad(x, y);
-		if (cquad == NULL)
-			// this means given x,y doesn't have a cooresponding quad
-			return new_streamline_points;
-		icVector2 cpos = icVector2(x, y);
-		// save npos (new position) into current_streamline_points
-		new_streamline_points.push_back(cpos);
-		icVector2 npos;
-		int step_counter = 0;
-		PolyLine pline;
-		while (cquad != NULL && step_counter < STEP_MAX)
-		{
-			cquad = streamline_step(cpos, npos, cquad, true);
-			if (!is_seed_point_valid(npos, d_test))
-				break;
-			LineSegment linear_seg = LineSegment(cpos.x, cpos.y, 0, npos.x, npos.y, 0);
-			pline.push_back(linear_seg);
-			cpos = npos;
-			// save npos (new position) into new_streamline_points
-			new_streamline_points.push_back(npos);
-			step_counter++;
-		}
-		streamlines.push_back(pline);
-	}
+	double steps[] = { 0.05, 0.1, 0.2 };
+	double d_seps[] = { 0.4, 0.6, 0.8, 1.2, 1.6 };
+	PlacementParams base = placement_params;
+	base.trace = false;
+	std::vector<PlacementParams> runs = sweep_grid(base, std::vector<double>(steps, steps + 3), std::vector<double>(d_seps, d_seps + 5));
 
-	{
-		Quad* cquad = poly->find_quad(x, y);
-		if (cquad == NULL)
-			// this means given x,y doesn't have a cooresponding quad
-			return new_streamline_points;
-		icVector2 cpos = icVector2(x, y);
-		icVector2 npos;
-		int step_counter = 0;
-		PolyLine pline;
-		while (cquad != NULL && step_counter < STEP_MAX)
-		{
-			cquad = streamline_step(cpos, npos, cquad, false);
-			if (!is_seed_point_valid(npos, d_test))
-				break;
-			LineSegment linear_seg = LineSegment(cpos.x, cpos.y, 0, npos.x, npos.y, 0);
-			pline.push_back(linear_seg);
-			cpos = npos;
-			// save npos (new position) into new_streamline_points
-			new_streamline_points.push_back(npos);
-			step_counter++;
-		}
-		streamlines.push_back(pline);
-	}
-	return new_streamline_points;
-}
+	std::vector<SweepResult> results;
+	auto start = std::chrono::steady_clock::now();
+	run_sweep(field, runs, nthreads, results);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+	print_sweep(results);
+	printf("%d runs in %.2f s\n", (int)runs.size(), seconds);
 
-Vertex* find_vertex(double xx, double yy) {
-	for (int i = 0; i < poly->nverts; i++) {
-		Vertex* v = poly->vlist[i];
-		if (v->x == xx && v->y == yy) {
-			return v;
-		}
-	}
-	return NULL;
+	unload_mesh();
+	return 0;
 }
 
-bool is_seed_point_valid(const icVector2 point, const float min_d) {
-	// 1. To check if a seed point is valid, we need to check if it exists in the polyhedron,
-	//		we can check this by checking if it exists in the vlist.
-	// 2. We also need to make sure the seed point has to be larger than D_sep far away from any other streamlines.
-	//		We can check this by checking it's distance to all the intermediate points of all streamlines is smaller than D_sep. (I think this is going to take a lot of time)
-	Quad* qtemp = poly->find_quad(point.x, point.y);
-	if (qtemp == NULL) return false;
-
-	for (int i = 0; i < all_steamline_points.size(); ++i) {
-		icVector2 ptemp = all_steamline_points[i];
-		float cur_distance = length(point - ptemp);
-		if (cur_distance < min_d)
-			return false;
-	}
+/******************************************************************************
+Place a multi-resolution hierarchy on one mesh, write it and read it back
+******************************************************************************/
 
-	for (int i = 0; i < current_streamline_points.size(); ++i) {
-		icVector2 ptemp = current_streamline_points[i];
-		float cur_distance = length(point - ptemp);
-		if (cur_distance < min_d)
-			return false;
+int run_hierarchy(const char* filename, int nlevels, const char* out_dir)
+{
+	if (!load_mesh(filename))
+		return 1;
+
+	PlacementParams params = placement_params;
+	for (int k = 0; k < nlevels; k++) {
+		auto start = std::chrono::steady_clock::now();
+		int added = hierarchy.add_level(*field->engine, params);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		printf("level %d: d_sep %g, %d streamlines added, %d in total, coverage %.3f, %.1f ms\n", k, hierarchy.d_seps[k], added,
+			hierarchy.level_end[k], field->engine->coverage(), ms);
 	}
 
-	// check if the point is too close to the points of streamlines in the queue
-	// create a temp queue that has the same info as queue
-	std::queue<std::vector<icVector2>> temp_q = queue;
-	while(!temp_q.empty()) {
-		// get one vector out of the queue
-		std::vector<icVector2> streamline_points = temp_q.front();
-		temp_q.pop();
-		for (int j = 0; j < streamline_points.size(); ++j) {
-			icVector2 ptemp = streamline_points[j];
-			float cur_distance = length(point - ptemp);
-			if (cur_distance < min_d)
-				return false;
-		}
+	std::string out = std::string(out_dir != NULL ? out_dir : ".") + "/" + field->name() + "_hierarchy.txt";
+	StreamlineHierarchy reloaded;
+	if (!hierarchy.write(out.c_str()) || !reloaded.read(out.c_str())) {
+		unload_mesh();
+		return 1;
 	}
-	return true;
-}
-
-// given a point and vector, find its +90 degree position
-icVector2 select_candidate_seed_point_clockwise(const float x, const float y, const float vx, const float vy) {
-	float new_vx = -vy;
-	float new_vy = vx;
-	float temp = sqrt(vy * vy + vx * vx); //distance
-	temp = temp / d_sep; // get ratio 
-	// increase or decrease vect
-	new_vx /= temp;
-	new_vy /= temp;
-	float new_x = x - new_vx;
-	float new_y = y - new_vy;
-	return icVector2(new_x, new_y);
-}
-
-// given a point and vector, find its -90 degree position
-icVector2 select_candidate_seed_point_counterclockwise(const float x, const float y, const float vx, const float vy) {
-	float new_vx = vy;
-	float new_vy = -vx;
-	float temp = sqrt(vy * vy + vx * vx); //distance
-	temp = temp / d_sep; // get ratio 
-	// increase or decrease vect
-	new_vx /= temp;
-	new_vy /= temp;
-	float new_x = x - new_vx;
-	float new_y = y - new_vy;
-	return icVector2(new_x, new_y);
-}
+	printf("written to %s, read back %d levels, %d streamlines\n", out.c_str(), reloaded.nlevels(), reloaded.lines.nlines());
 
-icVector2 calculate_vector(icVector2 point) {
-	Quad* cquad = poly->find_quad(point.x, point.y);
-	double x1, y1, x2, y2, f11, f12, f21, f22, g11, g21, g12, g22;
-	Vertex* v11, * v12, * v21, * v22;
-
-	x1 = poly->smallest_x(cquad);
-	x2 = poly->largest_x(cquad);
-	y1 = poly->smallest_y(cquad);
-	y2 = poly->largest_y(cquad);
-
-	v11 = find_vertex(x1, y1);
-	f11 = v11->vx;
-	g11 = v11->vy;
-
-	v12 = find_vertex(x1, y2);
-	f12 = v12->vx;
-	g12 = v12->vy;
-
-	v21 = find_vertex(x2, y1);
-	f21 = v21->vx;
-	g21 = v21->vy;
-
-	v22 = find_vertex(x2, y2);
-	f22 = v22->vx;
-	g22 = v22->vy;
-
-	double x0 = point.x;
-	double y0 = point.y;
-	icVector2 vect;
-	double m1 = (x2 - x0) * (y2 - y0) / (x2 - x1) / (y2 - y1);
-	double m2 = (x0 - x1) * (y2 - y0) / (x2 - x1) / (y2 - y1);
-	double m3 = (x2 - x0) * (y0 - y1) / (x2 - x1) / (y2 - y1);
-	double m4 = (x0 - x1) * (y0 - y1) / (x2 - x1) / (y2 - y1);
-	vect.x = m1 * f11 + m2 * f21 + m3 * f12 + m4 * f22;
-	vect.y = m1 * g11 + m2 * g21 + m3 * g12 + m4 * g22;
-	normalize(vect);
-	return vect;
+	unload_mesh();
+	return 0;
 }
 
-void evenly_spaced_algorithm() {
-	// original phase: compute an inital streamline and put it into the queue
-	// updated: compute an inital streamline, put its points vector into the queue
-	
-	// compute inital streamline and its points (saved in current_streamline_points)
-	// set current_streamline_points to be the inital streamline
-	// meanwhile, it will generate lines for inital streamline to draw on the screen
-	current_streamline_points = build_streamline(initial_x, initial_y);
-
-	bool finished = false;
-	while (finished == false) {
-		// select a candidate seed point at d = d_sep apart from the current streamline
-		// firstly, seclect a sample point for the streamline
-		icVector2 point;
-		icVector2 vet;
-		icVector2 candidate_point_clockwise;
-		icVector2 candidate_point_counterclockwise;
-		PolyLine pline;
-		for (int i = 0; i < current_streamline_points.size(); ++i) {
-			point = current_streamline_points[i];
-			// calculate this point's vx, vy
-			vet = calculate_vector(point);
-			// calculate two candidate points for the sample point
-			candidate_point_clockwise = select_candidate_seed_point_clockwise(point.x, point.y, vet.x, vet.y);
-			if ( is_seed_point_valid(candidate_point_clockwise, d_sep) ) {
-				// if a valid candidate has been selected 
-				// then compute a new streamline and put it into the queue
-				std::vector<icVector2> temp = build_streamline(candidate_point_clockwise.x, candidate_point_clockwise.y);
-				queue.push(temp);
-
-				// code for user to see how the streamlines are generated
-				if (traceOn) {
-					tracing_points.push_back(candidate_point_clockwise);
-					LineSegment linear_seg = LineSegment(point.x, point.y, 0, candidate_point_clockwise.x, candidate_point_clockwise.y, 0);
-					pline.push_back(linear_seg);
-					tracing_lines.push_back(pline);
-				}
-			}
-			
-			candidate_point_counterclockwise = select_candidate_seed_point_counterclockwise(point.x, point.y, vet.x, vet.y);
-			if ( is_seed_point_valid(candidate_point_counterclockwise, d_sep) ) {
-				// if a valid candidate has been selected 
-				// then compute a new streamline and put it into the queue
-				std::vector<icVector2> temp = build_streamline(candidate_point_counterclockwise.x, candidate_point_counterclockwise.y);
-				queue.push(temp);
-
-				if (traceOn) {
-					tracing_points.push_back(candidate_point_counterclockwise);
-					LineSegment linear_seg = LineSegment(point.x, point.y, 0, candidate_point_counterclockwise.x, candidate_point_counterclockwise.y, 0);
-					pline.push_back(linear_seg);
-					tracing_lines.push_back(pline);
-				}
-			}
+int run_skeleton(const std::vector<const char*>& files, int nthreads, const char* out_dir)
+{
+	int failed = 0;
+	for (int i = 0; i < files.size(); i++) {
+		FieldContext* ctx = FieldContext::load(files[i]);
+		if (ctx == NULL) {
+			failed++;
+			continue;
 		}
-		// here we have done using the current_streamline_points, put it into the all_streamline_points
-		for (int j = 0; j < current_streamline_points.size(); ++j)
-			all_steamline_points.push_back(current_streamline_points[j]);
-		// and clear out memory
-		current_streamline_points.clear();
-
-		// if there is no more available streamline in the queue
-		// set finished to true;
-		if(queue.empty())
-			finished = true;
-		// else let the next streamline in the queue be the current streamline
-		else {
-			current_streamline_points = queue.front();
-			queue.pop();
+
+		SkeletonParams params;
+		params.nthreads = nthreads;
+		TopologySkeleton skeleton;
+		auto start = std::chrono::steady_clock::now();
+		skeleton.build(*ctx->sampler, params);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		int to_sing = 0, to_boundary = 0;
+		for (int k = 0; k < skeleton.separatrices.size(); k++) {
+			if (skeleton.separatrices[k].end >= 0)
+				to_sing++;
+			else if (skeleton.separatrices[k].end == SEPARATRIX_BOUNDARY)
+				to_boundary++;
 		}
-		
+		printf("%s: %d singularities, %d saddles, %d separatrices to a singularity, %d to the boundary, %d open, %.1f ms\n",
+			ctx->name().c_str(), (int)skeleton.sings.size(), skeleton.nsaddles(), to_sing, to_boundary,
+			(int)skeleton.separatrices.size() - to_sing - to_boundary, ms);
+
+		std::string out = std::string(out_dir != NULL ? out_dir : ".") + "/" + ctx->name() + "_skeleton.txt";
+		if (!skeleton.write(out.c_str()))
+			failed++;
+		delete ctx;
 	}
-	return;
-}
\ No newline at end of file
+	return failed == 0 ? 0 : 1;
+}
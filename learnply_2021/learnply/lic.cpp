@@ -0,0 +1,242 @@
+/*
+
+Line integral convolution on the CPU
+
+*/
+
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include "lic.h"
+#include "packetTracer.h"
+
+/******************************************************************************
+Per-tile worker
+******************************************************************************/
+
+struct LICContext
+{
+	const FieldSampler* field;
+	const LICParams* params;
+	double sx, sy;					// pixel size in mesh units
+	std::vector<unsigned char> noise;
+	std::vector<float> sum;			// accumulated convolution per pixel
+	std::vector<int> hits;			// number of contributions per pixel
+	int ntiles_x, ntiles_y;
+	std::atomic<int> next_tile;
+};
+
+// pixel containing mesh point p, or -1 outside the image
+static int pixel_at(const LICContext& ctx, const icVector2& p)
+{
+	const CellIndex* index = ctx.field->index;
+	int i = (int)floor((p.x - index->xmin) / ctx.sx);
+	int j = (int)floor((index->ymax - p.y) / ctx.sy);
+	if (i < 0 || i >= ctx.params->width || j < 0 || j >= ctx.params->height)
+		return -1;
+	return j * ctx.params->width + i;
+}
+
+// seeds traced together; each takes a backward and a forward lane
+static const int LIC_SEEDS = PACKET_WIDTH / 2;
+
+// scratch space of a worker
+struct LICScratch
+{
+	StreamlinePacket packet;
+	std::vector<int> back[LIC_SEEDS], fwd[LIC_SEEDS];	// pixels along each half streamline
+	std::vector<int> line;
+	std::vector<float> prefix;
+
+	LICScratch(const FieldSampler* field) : packet(field) { packet.min_speed = EPS; }
+};
+
+// traces up to n midpoint steps from every seed in both directions at
+// once, appending the pixel of every sample to back and fwd
+static void trace_seeds(const LICContext& ctx, LICScratch& s, const icVector2* seeds, int nseeds, double h, int n)
+{
+	s.packet.clear();
+	for (int k = 0; k < nseeds; k++) {
+		s.packet.add(seeds[k].x, seeds[k].y, -h);
+		s.packet.add(seeds[k].x, seeds[k].y, h);
+		s.back[k].clear();
+		s.fwd[k].clear();
+	}
+	for (int k = 0; k < n && s.packet.step(PACKET_MIDPOINT) > 0; k++)
+		for (int l = 0; l < s.packet.nlanes; l++) {
+			if (!s.packet.active(l))
+				continue;
+			int pix = pixel_at(ctx, icVector2(s.packet.x[l], s.packet.y[l]));
+			if (pix < 0)
+				s.packet.stop(l);
+			else if (l & 1)
+				s.fwd[l / 2].push_back(pix);
+			else
+				s.back[l / 2].push_back(pix);
+		}
+}
+
+// convolves the noise along the streamlines of the seeds, in seed order; a
+// seed whose pixel got a value from an earlier streamline of the batch is
+// skipped, as it would have been if the seeds were traced one by one
+static void convolve_seeds(LICContext& ctx, LICScratch& s, const icVector2* seeds, const int* seed_pixels, int nseeds,
+	int i0, int j0, int i1, int j1)
+{
+	const LICParams& params = *ctx.params;
+	int L = params.kernel_length;
+	int n = L + params.extension;
+	double h = params.step * fmin(ctx.sx, ctx.sy);
+	trace_seeds(ctx, s, seeds, nseeds, h, n);
+
+	for (int q = 0; q < nseeds; q++) {
+		int seed_pix = seed_pixels[q];
+		if (ctx.hits[seed_pix] > 0)
+			continue;
+
+		// streamline through the seed, as a list of pixels from the
+		// backward end to the forward end
+		std::vector<int>& line = s.line;
+		line.assign(s.back[q].rbegin(), s.back[q].rend());
+		line.push_back(seed_pix);
+		line.insert(line.end(), s.fwd[q].begin(), s.fwd[q].end());
+
+		// prefix sums of the noise turn every box filter into one subtraction
+		int m = (int)line.size();
+		std::vector<float>& prefix = s.prefix;
+		prefix.resize(m + 1);
+		prefix[0] = 0;
+		for (int k = 0; k < m; k++)
+			prefix[k + 1] = prefix[k] + ctx.noise[line[k]];
+
+		// slide the kernel along the streamline; samples whose kernel is
+		// cut to less than half by the streamline ends are skipped, except
+		// for the seed itself
+		int seed_k = (int)s.back[q].size();
+		for (int k = 0; k < m; k++) {
+			int lo = k - L < 0 ? 0 : k - L;
+			int hi = k + L > m - 1 ? m - 1 : k + L;
+			if (hi - lo < L && k != seed_k)
+				continue;
+
+			int pix = line[k];
+			int pi = pix % params.width, pj = pix / params.width;
+			if (pi < i0 || pi >= i1 || pj < j0 || pj >= j1)
+				continue;
+			ctx.sum[pix] += (prefix[hi + 1] - prefix[lo]) / (hi - lo + 1);
+			ctx.hits[pix]++;
+		}
+	}
+}
+
+static void process_tile(LICContext& ctx, int tile, LICScratch& s)
+{
+	const LICParams& params = *ctx.params;
+	const CellIndex* index = ctx.field->index;
+
+	int i0 = (tile % ctx.ntiles_x) * params.tile_size;
+	int j0 = (tile / ctx.ntiles_x) * params.tile_size;
+	int i1 = i0 + params.tile_size < params.width ? i0 + params.tile_size : params.width;
+	int j1 = j0 + params.tile_size < params.height ? j0 + params.tile_size : params.height;
+
+	// pixels without a value are seeded in scan order, LIC_SEEDS at a time
+	icVector2 seeds[LIC_SEEDS];
+	int seed_pixels[LIC_SEEDS];
+	int nseeds = 0;
+	for (int j = j0; j < j1; j++)
+		for (int i = i0; i < i1; i++) {
+			int seed_pix = j * params.width + i;
+			if (ctx.hits[seed_pix] > 0)
+				continue;
+
+			icVector2 seed(index->xmin + (i + 0.5) * ctx.sx, index->ymax - (j + 0.5) * ctx.sy);
+			if (index->find_quad_id(seed.x, seed.y) < 0)
+				continue;
+			seeds[nseeds] = seed;
+			seed_pixels[nseeds++] = seed_pix;
+			if (nseeds == LIC_SEEDS) {
+				convolve_seeds(ctx, s, seeds, seed_pixels, nseeds, i0, j0, i1, j1);
+				nseeds = 0;
+			}
+		}
+	if (nseeds > 0)
+		convolve_seeds(ctx, s, seeds, seed_pixels, nseeds, i0, j0, i1, j1);
+}
+
+static void lic_worker(LICContext* ctx)
+{
+	LICScratch scratch(ctx->field);
+	int ntiles = ctx->ntiles_x * ctx->ntiles_y;
+	for (int tile = ctx->next_tile++; tile < ntiles; tile = ctx->next_tile++)
+		process_tile(*ctx, tile, scratch);
+}
+
+/******************************************************************************
+Compute a LIC image
+******************************************************************************/
+
+void compute_lic(const FieldSampler& field, const LICParams& params, std::vector<unsigned char>& gray)
+{
+	const CellIndex* index = field.index;
+	int npix = params.width * params.height;
+
+	LICContext ctx;
+	ctx.field = &field;
+	ctx.params = &params;
+	ctx.sx = (index->xmax - index->xmin) / params.width;
+	ctx.sy = (index->ymax - index->ymin) / params.height;
+	ctx.sum.assign(npix, 0.0f);
+	ctx.hits.assign(npix, 0);
+	ctx.ntiles_x = (params.width + params.tile_size - 1) / params.tile_size;
+	ctx.ntiles_y = (params.height + params.tile_size - 1) / params.tile_size;
+	ctx.next_tile = 0;
+
+	// white noise input texture
+	ctx.noise.resize(npix);
+	unsigned int state = params.noise_seed ? params.noise_seed : 1;
+	for (int k = 0; k < npix; k++) {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		ctx.noise[k] = (state >> 24) & 0x80 ? 255 : 0;
+	}
+
+	int nthreads = params.nthreads > 0 ? params.nthreads : (int)std::thread::hardware_concurrency();
+	if (nthreads < 1)
+		nthreads = 1;
+	std::vector<std::thread> workers;
+	for (int t = 1; t < nthreads; t++)
+		workers.push_back(std::thread(lic_worker, &ctx));
+	lic_worker(&ctx);
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	// average the contributions and stretch the contrast, the box filter
+	// pulls the values towards the noise mean
+	double mean = 0, var = 0;
+	int nvalid = 0;
+	for (int k = 0; k < npix; k++) {
+		if (ctx.hits[k] == 0)
+			continue;
+		ctx.sum[k] /= ctx.hits[k];
+		mean += ctx.sum[k];
+		nvalid++;
+	}
+	if (nvalid > 0)
+		mean /= nvalid;
+	for (int k = 0; k < npix; k++)
+		if (ctx.hits[k] > 0)
+			var += (ctx.sum[k] - mean) * (ctx.sum[k] - mean);
+	double sigma = nvalid > 0 ? sqrt(var / nvalid) : 1.0;
+	if (sigma < EPS)
+		sigma = 1.0;
+
+	gray.resize(npix);
+	for (int k = 0; k < npix; k++) {
+		if (ctx.hits[k] == 0) {
+			gray[k] = 255;
+			continue;
+		}
+		double v = 127.5 + 127.5 * (ctx.sum[k] - mean) / (2.5 * sigma);
+		gray[k] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+	}
+}
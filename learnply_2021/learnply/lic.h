@@ -0,0 +1,33 @@
+/*
+
+Line integral convolution on the CPU
+
+Implements Fast-LIC (Stalling and Hege 1995): every streamline that is
+traced is used for all pixels it crosses, the box filter is slid along
+the streamline instead of being recomputed for each pixel. The image is
+split into tiles that are processed in parallel; a tile only writes its
+own pixels, so no locking is needed. Within a tile the streamlines of
+several seeds are traced in lockstep as one StreamlinePacket.
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldSampler.h"
+
+struct LICParams
+{
+	int width = 1024;			// output size in pixels
+	int height = 1024;
+	int kernel_length = 20;		// half length L of the box kernel, in integration steps
+	int extension = 60;			// steps traced beyond the kernel on each side, reused for other pixels
+	double step = 0.5;			// integration step in pixels
+	int tile_size = 64;			// tiles are the unit of parallel work
+	int nthreads = 0;			// 0 uses one thread per hardware thread
+	unsigned int noise_seed = 1;
+};
+
+// computes a LIC image of the field, covering the bounds of the mesh
+// gray receives width*height bytes, rows from top to bottom; pixels outside
+// the mesh are set to white
+void compute_lic(const FieldSampler& field, const LICParams& params, std::vector<unsigned char>& gray);
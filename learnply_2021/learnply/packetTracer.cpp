@@ -0,0 +1,119 @@
+/*
+
+Lockstep tracing of many streamlines
+
+*/
+
+#include "packetTracer.h"
+
+StreamlinePacket::StreamlinePacket(const FieldSampler* field_in)
+{
+	field = field_in;
+	nlanes = 0;
+	min_speed = 0;
+}
+
+int StreamlinePacket::add(double x0, double y0, double h0)
+{
+	if (nlanes == PACKET_WIDTH)
+		return -1;
+	int lane = nlanes++;
+	x[lane] = x0;
+	y[lane] = y0;
+	h[lane] = h0;
+	cell[lane] = field->index->find_quad_id(x0, y0);
+	state[lane] = cell[lane] >= 0 ? LANE_ACTIVE : LANE_BOUNDARY;
+	return lane;
+}
+
+void StreamlinePacket::end(int lane, LaneState why)
+{
+	state[lane] = why;
+	cell[lane] = -1;
+}
+
+void StreamlinePacket::stop(int lane)
+{
+	if (active(lane))
+		end(lane, LANE_STOPPED);
+}
+
+// moves the quad of every active lane to the one holding its stage
+// position; the quad it was in is tried first
+void StreamlinePacket::locate()
+{
+	const CellIndex& index = *field->index;
+	for (int l = 0; l < nlanes; l++) {
+		if (!active(l))
+			continue;
+		int c = cell[l];
+		if (sx[l] < index.qx1[c] || sx[l] > index.qx2[c] || sy[l] < index.qy1[c] || sy[l] > index.qy2[c])
+			c = index.find_quad_id(sx[l], sy[l]);
+		if (c < 0)
+			end(l, LANE_BOUNDARY);
+		else
+			cell[l] = c;
+	}
+}
+
+// normalized directions at the stage positions of all lanes in one batch;
+// the ended lanes have no quad and are skipped by the sampler
+void StreamlinePacket::sample_stage(int k)
+{
+	field->sample_batch(nlanes, cell, sx, sy, kx[k], ky[k], true, speed);
+	for (int l = 0; l < nlanes; l++)
+		if (active(l) && (speed[l] == 0 || speed[l] < min_speed))
+			end(l, LANE_ZERO);
+}
+
+int StreamlinePacket::step(PacketScheme scheme)
+{
+	for (int l = 0; l < nlanes; l++) {
+		sx[l] = x[l];
+		sy[l] = y[l];
+	}
+	sample_stage(0);
+
+	if (scheme == PACKET_MIDPOINT) {
+		for (int l = 0; l < nlanes; l++) {
+			sx[l] = x[l] + 0.5 * h[l] * kx[0][l];
+			sy[l] = y[l] + 0.5 * h[l] * ky[0][l];
+		}
+		locate();
+		sample_stage(1);
+		for (int l = 0; l < nlanes; l++)
+			if (active(l)) {
+				x[l] += h[l] * kx[1][l];
+				y[l] += h[l] * ky[1][l];
+			}
+	}
+	else {
+		// stages at half a step along k0 and k1, then a full step along k2
+		for (int k = 1; k < 4; k++) {
+			double f = k < 3 ? 0.5 : 1.0;
+			for (int l = 0; l < nlanes; l++) {
+				sx[l] = x[l] + f * h[l] * kx[k - 1][l];
+				sy[l] = y[l] + f * h[l] * ky[k - 1][l];
+			}
+			locate();
+			sample_stage(k);
+		}
+		for (int l = 0; l < nlanes; l++)
+			if (active(l)) {
+				x[l] += h[l] / 6 * (kx[0][l] + 2 * kx[1][l] + 2 * kx[2][l] + kx[3][l]);
+				y[l] += h[l] / 6 * (ky[0][l] + 2 * ky[1][l] + 2 * ky[2][l] + ky[3][l]);
+			}
+	}
+
+	// quads of the new fronts
+	int nactive = 0;
+	for (int l = 0; l < nlanes; l++) {
+		sx[l] = x[l];
+		sy[l] = y[l];
+	}
+	locate();
+	for (int l = 0; l < nlanes; l++)
+		if (active(l))
+			nactive++;
+	return nactive;
+}
@@ -0,0 +1,82 @@
+/*
+
+Lockstep tracing of many streamlines
+
+A StreamlinePacket holds up to PACKET_WIDTH streamline fronts that are
+advanced together, one step at a time. The fronts are kept as arrays, so
+every stage of the integrator samples all of them with a single
+FieldSampler::sample_batch call; lanes that have ended are masked off by
+handing the sampler no quad. A front ends when it leaves the mesh or
+runs into a zero of the field, or when the caller stops it. Only fronts
+that leave their quad are looked up in the CellIndex again.
+
+Meant for independent traces: the fronts of a packet do not see each
+other.
+
+*/
+
+#pragma once
+#include "fieldSampler.h"
+
+const int PACKET_WIDTH = 16;	// two AVX-512 or four AVX2 sampler iterations
+
+enum PacketScheme
+{
+	PACKET_MIDPOINT,			// second order Runge-Kutta
+	PACKET_RK4					// fourth order Runge-Kutta
+};
+
+enum LaneState
+{
+	LANE_ACTIVE,
+	LANE_BOUNDARY,				// a stage or the new front left the mesh
+	LANE_ZERO,					// the field magnitude fell to min_speed
+	LANE_STOPPED				// ended by stop()
+};
+
+class StreamlinePacket
+{
+public:
+
+	// fields
+	int nlanes;
+	double x[PACKET_WIDTH], y[PACKET_WIDTH];	// front of every lane
+	double h[PACKET_WIDTH];					// signed step length of every lane, along the normalized field
+	int cell[PACKET_WIDTH];					// quad of every front, -1 once the lane has ended
+	LaneState state[PACKET_WIDTH];
+	double min_speed;						// fronts end where the field magnitude is below this, or zero
+
+	// constructors
+
+	StreamlinePacket(const FieldSampler* field);
+
+	// methods
+
+	void clear() { nlanes = 0; }
+
+	// starts a front at (x,y); a negative h traces backward. Returns its
+	// lane, or -1 if the packet is full. A front off the mesh starts ended.
+	int add(double x, double y, double h);
+
+	bool active(int lane) const { return state[lane] == LANE_ACTIVE; }
+	void stop(int lane);
+
+	// advances every active front by one step and returns the number of
+	// fronts still active. A front that ends during the step keeps the
+	// position it reached last.
+	int step(PacketScheme scheme);
+
+private:
+
+	const FieldSampler* field;
+
+	// positions of the current stage and the normalized directions sampled
+	// at each stage
+	double sx[PACKET_WIDTH], sy[PACKET_WIDTH];
+	double kx[4][PACKET_WIDTH], ky[4][PACKET_WIDTH];
+	double speed[PACKET_WIDTH];
+
+	void end(int lane, LaneState why);
+	void locate();
+	void sample_stage(int k);
+};
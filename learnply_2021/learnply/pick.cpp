@@ -0,0 +1,89 @@
+/*
+
+CPU picking of mesh elements
+
+*/
+
+#include <math.h>
+#include "pick.h"
+
+/******************************************************************************
+Unproject a window position onto the mesh plane.
+
+set_view loads an orthographic projection and set_scene builds the
+modelview matrix T(translation, -3) * R * S(0.9 / radius) * T(-center),
+where R is rotmat loaded through glMultMatrixf, i.e. its transpose.
+The inverse is applied to the viewing ray through the pixel.
+******************************************************************************/
+
+bool unproject_to_mesh(const PickView& view, Polyhedron* poly, int x, int y, icVector3& p)
+{
+	double aspect = (double)view.win_width / (double)view.win_height;
+	double half_w, half_h;
+	if (aspect >= 1.0) {
+		half_w = view.radius_factor * view.zoom * aspect;
+		half_h = view.radius_factor * view.zoom;
+	}
+	else {
+		half_w = view.radius_factor * view.zoom;
+		half_h = view.radius_factor * view.zoom / aspect;
+	}
+
+	// eye space ray: origin on the z = 0 plane, looking down -z
+	double s = (2.0 * x - view.win_width) / view.win_width;
+	double t = (2.0 * (view.win_height - y) - view.win_height) / view.win_height;
+	double eye[3] = { s * half_w - view.translation[0], t * half_h - view.translation[1], 3.0 };
+
+	// undo the rotation (the inverse of rotmat^T is rotmat) and the scaling
+	double scale = poly->radius / 0.9;
+	double origin[3], dir[3];
+	for (int k = 0; k < 3; k++) {
+		origin[k] = scale * (view.rotmat[k][0] * eye[0] + view.rotmat[k][1] * eye[1] + view.rotmat[k][2] * eye[2]);
+		dir[k] = -scale * view.rotmat[k][2];
+	}
+
+	// intersect with the plane through the mesh center
+	if (fabs(dir[2]) < EPS)
+		return false;
+	double lambda = -origin[2] / dir[2];
+	p.x = poly->center.entry[0] + origin[0] + lambda * dir[0];
+	p.y = poly->center.entry[1] + origin[1] + lambda * dir[1];
+	p.z = poly->center.entry[2];
+	return true;
+}
+
+bool visible_rect(const PickView& view, Polyhedron* poly, double rect[4])
+{
+	int corners[4][2] = { { 0, 0 }, { view.win_width, 0 }, { 0, view.win_height }, { view.win_width, view.win_height } };
+	for (int k = 0; k < 4; k++) {
+		icVector3 p;
+		if (!unproject_to_mesh(view, poly, corners[k][0], corners[k][1], p))
+			return false;
+		if (k == 0 || p.x < rect[0]) rect[0] = p.x;
+		if (k == 0 || p.y < rect[1]) rect[1] = p.y;
+		if (k == 0 || p.x > rect[2]) rect[2] = p.x;
+		if (k == 0 || p.y > rect[3]) rect[3] = p.y;
+	}
+	return true;
+}
+
+/******************************************************************************
+Pick elements
+******************************************************************************/
+
+int pick_quad(const CellIndex& index, const PickView& view, int x, int y)
+{
+	icVector3 p;
+	if (!unproject_to_mesh(view, index.mesh(), x, y, p))
+		return -1;
+	return index.find_quad_id(p.x, p.y);
+}
+
+int pick_vertex(const CellIndex& index, const PickView& view, int x, int y, double max_dist)
+{
+	icVector3 p;
+	if (!unproject_to_mesh(view, index.mesh(), x, y, p))
+		return -1;
+	Vertex* v = index.nearest_vertex(p.x, p.y, max_dist);
+	return v == NULL ? -1 : v->index;
+}
@@ -0,0 +1,38 @@
+/*
+
+CPU picking of mesh elements
+
+The cursor is unprojected into mesh space with the same transforms that
+set_view and set_scene hand to OpenGL, and the hit is looked up in a
+CellIndex. No GL context is needed.
+
+*/
+
+#pragma once
+#include "cellIndex.h"
+
+// the part of the viewer state that defines the mesh-to-window transform
+struct PickView
+{
+	int win_width, win_height;
+	double zoom;
+	double translation[2];
+	float rotmat[4][4];
+	double radius_factor;
+};
+
+// unprojects window pixel (x,y) (origin at the top left, like GLUT) onto
+// the z = center.z plane of the mesh; returns false if the view looks
+// along that plane
+bool unproject_to_mesh(const PickView& view, Polyhedron* poly, int x, int y, icVector3& p);
+
+// bounding rectangle {xmin, ymin, xmax, ymax} of the part of the mesh
+// plane covered by the window; false if the view looks along that plane
+bool visible_rect(const PickView& view, Polyhedron* poly, double rect[4]);
+
+// index into poly->qlist of the quad under the cursor, or -1
+int pick_quad(const CellIndex& index, const PickView& view, int x, int y);
+
+// index into poly->vlist of the vertex nearest the cursor within max_dist
+// (mesh units), or -1
+int pick_vertex(const CellIndex& index, const PickView& view, int x, int y, double max_dist);
@@ -0,0 +1,172 @@
+/*
+
+Parameter sweeps of the streamline placement
+
+*/
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "placementSweep.h"
+
+struct SweepContext
+{
+	const FieldContext* field;
+	const std::vector<PlacementParams>* runs;
+	std::vector<SweepResult>* results;
+	std::atomic<int> next_run;
+};
+
+// takes runs until none are left; the engine and its buffers are reused
+// from one run to the next
+static void sweep_worker(SweepContext* ctx)
+{
+	StreamlineEngine engine(ctx->field->sampler);
+	for (int i = ctx->next_run++; i < ctx->runs->size(); i = ctx->next_run++) {
+		const PlacementParams& params = (*ctx->runs)[i];
+		auto start = std::chrono::steady_clock::now();
+		engine.run(params);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		SweepResult& r = (*ctx->results)[i];
+		r.name = ctx->field->name();
+		r.params = params;
+		r.seconds = seconds;
+		r.nstreamlines = engine.streamlines.nlines();
+		r.npoints = engine.streamlines.npoints();
+		r.nsteps = engine.nsteps();
+		r.ncandidates = engine.ncandidates();
+		r.nrejected = engine.nrejected();
+		r.coverage = engine.coverage();
+	}
+}
+
+void run_sweep(const FieldContext* field, const std::vector<PlacementParams>& runs, int nthreads, std::vector<SweepResult>& results)
+{
+	results.resize(runs.size());
+
+	SweepContext ctx;
+	ctx.field = field;
+	ctx.runs = &runs;
+	ctx.results = &results;
+	ctx.next_run = 0;
+
+	if (nthreads <= 0)
+		nthreads = (int)std::thread::hardware_concurrency();
+	if (nthreads > (int)runs.size())
+		nthreads = (int)runs.size();
+	if (nthreads < 1)
+		nthreads = 1;
+
+	std::vector<std::thread> workers;
+	for (int t = 1; t < nthreads; t++)
+		workers.push_back(std::thread(sweep_worker, &ctx));
+	sweep_worker(&ctx);
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+/******************************************************************************
+One parameter set over many fields
+******************************************************************************/
+
+struct FieldBatch
+{
+	const std::vector<const char*>* files;
+	const PlacementParams* params;
+	const char* out_dir;
+	std::vector<SweepResult>* results;
+	std::atomic<int> next_file;
+};
+
+static void field_worker(FieldBatch* batch)
+{
+	for (int i = batch->next_file++; i < batch->files->size(); i = batch->next_file++) {
+		SweepResult& r = (*batch->results)[i];
+		r.name = (*batch->files)[i];
+		r.params = *batch->params;
+		r.seconds = 0;
+		r.nstreamlines = r.npoints = -1;
+		r.nsteps = 0;
+		r.ncandidates = r.nrejected = 0;
+		r.coverage = 0;
+
+		FieldContext* field = FieldContext::load((*batch->files)[i]);
+		if (field == NULL)
+			continue;
+		r.name = field->name();
+
+		auto start = std::chrono::steady_clock::now();
+		field->engine->run(r.params);
+		r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		r.nstreamlines = field->engine->streamlines.nlines();
+		r.npoints = field->engine->streamlines.npoints();
+		r.nsteps = field->engine->nsteps();
+		r.ncandidates = field->engine->ncandidates();
+		r.nrejected = field->engine->nrejected();
+		r.coverage = field->engine->coverage();
+
+		if (batch->out_dir != NULL)
+			field->engine->streamlines.write((std::string(batch->out_dir) + "/" + r.name + "_streamlines.txt").c_str());
+		delete field;
+	}
+}
+
+void place_fields(const std::vector<const char*>& files, const PlacementParams& params, int nthreads, const char* out_dir, std::vector<SweepResult>& results)
+{
+	results.resize(files.size());
+
+	FieldBatch batch;
+	batch.files = &files;
+	batch.params = &params;
+	batch.out_dir = out_dir;
+	batch.results = &results;
+	batch.next_file = 0;
+
+	if (nthreads <= 0)
+		nthreads = (int)std::thread::hardware_concurrency();
+	if (nthreads > (int)files.size())
+		nthreads = (int)files.size();
+	if (nthreads < 1)
+		nthreads = 1;
+
+	std::vector<std::thread> workers;
+	for (int t = 1; t < nthreads; t++)
+		workers.push_back(std::thread(field_worker, &batch));
+	field_worker(&batch);
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+}
+
+/******************************************************************************
+Parameter grids and reports
+******************************************************************************/
+
+std::vector<PlacementParams> sweep_grid(const PlacementParams& base, const std::vector<double>& steps, const std::vector<double>& d_seps)
+{
+	std::vector<PlacementParams> runs;
+	for (int i = 0; i < d_seps.size(); i++)
+		for (int j = 0; j < steps.size(); j++) {
+			PlacementParams params = base;
+			params.step = steps[j];
+			params.d_sep = d_seps[i];
+			runs.push_back(params);
+		}
+	return runs;
+}
+
+void print_sweep(const std::vector<SweepResult>& results)
+{
+	printf("%-12s %8s %8s %8s %10s %8s %10s %10s %10s %9s %9s\n", "field", "d_sep", "d_test", "step", "time (ms)", "lines", "points", "steps",
+		"candidates", "rejected", "coverage");
+	for (int i = 0; i < results.size(); i++) {
+		const SweepResult& r = results[i];
+		if (r.nstreamlines < 0) {
+			printf("%-12s could not be read\n", r.name.c_str());
+			continue;
+		}
+		printf("%-12s %8.3f %8.3f %8.3f %10.2f %8d %10d %10lld %10lld %9lld %8.1f%%\n", r.name.c_str(), r.params.d_sep, r.params.d_test(), r.params.step,
+			r.seconds * 1000.0, r.nstreamlines, r.npoints, r.nsteps, r.ncandidates, r.nrejected, r.coverage * 100.0);
+	}
+}
@@ -0,0 +1,45 @@
+/*
+
+Parameter sweeps of the streamline placement
+
+Runs many placement parameter sets over one loaded mesh. The runs are
+spread over worker threads, each with its own StreamlineEngine; the mesh,
+CellIndex and FieldSampler are shared read-only.
+
+place_fields runs one parameter set over many ply files, each worker
+loading its own FieldContext.
+
+*/
+
+#pragma once
+#include <vector>
+#include <string>
+#include "fieldContext.h"
+
+struct SweepResult
+{
+	std::string name;		// field the run was made on, for place_fields
+	PlacementParams params;
+	double seconds;			// wall time of the placement
+	int nstreamlines;
+	int npoints;
+	long long nsteps;		// integration steps taken
+	long long ncandidates;	// candidate seeds tested
+	long long nrejected;	// candidate seeds too close to a streamline or off the mesh
+	double coverage;		// see StreamlineEngine::coverage
+};
+
+// runs every parameter set in runs; results[i] belongs to runs[i]
+// nthreads 0 uses one thread per hardware thread
+void run_sweep(const FieldContext* field, const std::vector<PlacementParams>& runs, int nthreads, std::vector<SweepResult>& results);
+
+// the cross product of the given step sizes and separating distances, all
+// other parameters taken from base
+std::vector<PlacementParams> sweep_grid(const PlacementParams& base, const std::vector<double>& steps, const std::vector<double>& d_seps);
+
+// places streamlines on every file; results[i] belongs to files[i] and
+// has nstreamlines -1 if the file could not be read. With an out_dir the
+// streamlines are written to <out_dir>/<name>_streamlines.txt
+void place_fields(const std::vector<const char*>& files, const PlacementParams& params, int nthreads, const char* out_dir, std::vector<SweepResult>& results);
+
+void print_sweep(const std::vector<SweepResult>& results);
@@ -0,0 +1,171 @@
+/*
+
+Streamline tracing specialized at compile time
+
+*/
+
+#include "policyTracer.h"
+
+/******************************************************************************
+Dispatch: one switch per policy, resolved once per streamline
+******************************************************************************/
+
+template <class Real, class Integrator, int Sign, class Norm, class Sampler>
+static int dispatch_stop(const Sampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	switch (config.stop) {
+	case TRACE_STOP_SLOW:
+		return trace_policy<Real, Integrator, Sign, Norm, StopWhenSlow>(field, seed, config, points);
+	case TRACE_STOP_SINGULARITY:
+		return trace_policy<Real, Integrator, Sign, Norm, StopNearSingularity>(field, seed, config, points);
+	default:
+		return trace_policy<Real, Integrator, Sign, Norm, StopAtBoundary>(field, seed, config, points);
+	}
+}
+
+template <class Real, class Integrator, int Sign, class Sampler>
+static int dispatch_norm(const Sampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	if (config.normalize)
+		return dispatch_stop<Real, Integrator, Sign, UnitSpeed>(field, seed, config, points);
+	return dispatch_stop<Real, Integrator, Sign, FieldSpeed>(field, seed, config, points);
+}
+
+template <class Real, class Integrator, class Sampler>
+static int dispatch_direction(const Sampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	if (config.forward)
+		return dispatch_norm<Real, Integrator, 1>(field, seed, config, points);
+	return dispatch_norm<Real, Integrator, -1>(field, seed, config, points);
+}
+
+template <class Real, class Sampler>
+static int dispatch_integrator(const Sampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	switch (config.integrator) {
+	case TRACE_EULER:
+		return dispatch_direction<Real, EulerStep>(field, seed, config, points);
+	case TRACE_RK4:
+		return dispatch_direction<Real, RK4Step>(field, seed, config, points);
+	default:
+		return dispatch_direction<Real, MidpointStep>(field, seed, config, points);
+	}
+}
+
+int trace_streamline(const FieldSampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	if (config.precision == TRACE_FLOAT)
+		return dispatch_integrator<float>(field, seed, config, points);
+	return dispatch_integrator<double>(field, seed, config, points);
+}
+
+int trace_streamline(const FloatFieldSampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	if (config.precision == TRACE_FLOAT)
+		return dispatch_integrator<float>(field, seed, config, points);
+	return dispatch_integrator<double>(field, seed, config, points);
+}
+
+/******************************************************************************
+Reference tracer with the configuration tested at every step. Does the
+arithmetic of the double instantiations in the same order, so both give
+the same points.
+******************************************************************************/
+
+// quad of (x,y), trying cell first; -1 off the mesh
+static int generic_locate(const CellIndex& index, int cell, double x, double y)
+{
+	if (cell < 0 || x < index.qx1[cell] || x > index.qx2[cell] || y < index.qy1[cell] || y > index.qy2[cell])
+		return index.find_quad_id(x, y);
+	return cell;
+}
+
+static bool generic_at(const FieldSampler& field, const TraceConfig& config, int& cell, double x, double y,
+	double& vx, double& vy, double& speed)
+{
+	cell = generic_locate(*field.index, cell, x, y);
+	if (cell < 0)
+		return false;
+	icVector2 v;
+	field.sample_in_cell(cell, x, y, v);
+	vx = v.x;
+	vy = v.y;
+	speed = sqrt(vx * vx + vy * vy);
+	if (speed == 0)
+		return false;
+	double s = (config.forward ? 1 : -1) * (config.normalize ? 1 / speed : 1);
+	vx *= s;
+	vy *= s;
+	return true;
+}
+
+int trace_streamline_generic(const FieldSampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	const CellIndex& index = *field.index;
+	double x = seed.x, y = seed.y, h = config.h;
+	int cell = generic_locate(index, -1, x, y);
+	if (cell < 0)
+		return 0;
+	double capture2 = config.capture * config.capture;
+	int n = 0;
+	for (; n < config.max_steps; n++) {
+		double kx[4], ky[4], speed, s;
+		bool ok = generic_at(field, config, cell, x, y, kx[0], ky[0], speed);
+		double nx = x, ny = y;
+		switch (config.integrator) {
+		case TRACE_EULER:
+			nx += h * kx[0];
+			ny += h * ky[0];
+			break;
+		case TRACE_RK2:
+			ok = ok && generic_at(field, config, cell, x + 0.5 * h * kx[0], y + 0.5 * h * ky[0], kx[1], ky[1], s);
+			nx += h * kx[1];
+			ny += h * ky[1];
+			break;
+		case TRACE_RK4:
+			ok = ok && generic_at(field, config, cell, x + 0.5 * h * kx[0], y + 0.5 * h * ky[0], kx[1], ky[1], s) &&
+				generic_at(field, config, cell, x + 0.5 * h * kx[1], y + 0.5 * h * ky[1], kx[2], ky[2], s) &&
+				generic_at(field, config, cell, x + h * kx[2], y + h * ky[2], kx[3], ky[3], s);
+			nx += h / 6 * (kx[0] + 2 * kx[1] + 2 * kx[2] + kx[3]);
+			ny += h / 6 * (ky[0] + 2 * ky[1] + 2 * ky[2] + ky[3]);
+			break;
+		}
+		if (!ok)
+			break;
+		cell = generic_locate(index, cell, nx, ny);
+		if (cell < 0)
+			break;
+
+		bool stop = false;
+		switch (config.stop) {
+		case TRACE_STOP_SLOW:
+			stop = speed < config.min_speed;
+			break;
+		case TRACE_STOP_SINGULARITY:
+			if (config.sings != NULL) {
+				const std::vector<Singularity>& sings = *config.sings;
+				int lo = 0, hi = (int)sings.size();
+				while (lo < hi) {
+					int mid = (lo + hi) / 2;
+					if (sings[mid].quad < cell)
+						lo = mid + 1;
+					else
+						hi = mid;
+				}
+				for (int i = lo; i < sings.size() && sings[i].quad == cell && !stop; i++) {
+					double dx = nx - sings[i].pos.x, dy = ny - sings[i].pos.y;
+					stop = dx * dx + dy * dy < capture2;
+				}
+			}
+			break;
+		default:
+			break;
+		}
+		if (stop)
+			break;
+		x = nx;
+		y = ny;
+		points.push_back(icVector2(x, y));
+	}
+	return n;
+}
@@ -0,0 +1,291 @@
+/*
+
+Streamline tracing specialized at compile time
+
+trace_policy is one streamline tracer written against five policies: the
+integrator (Euler, midpoint RK2, RK4), the direction (+1 or -1), the
+precision of the arithmetic (float or double), the normalization of the
+field (unit speed, so the step is arc length, or the field itself, so the
+step is time) and the termination test. Every choice is a template
+argument, so each configuration compiles to its own inner loop with no
+tests on the configuration left in it; the only branches are the ones on
+the data (leaving the quad, the mesh or a stop).
+
+trace_streamline picks the instantiation for a TraceConfig at run time,
+once per streamline, for the double FieldSampler or its float copy
+(floatSampler.h). trace_streamline_generic does the same tracing with
+the configuration tested at every step, in double precision; it is the
+reference the specialized loops are checked and timed against
+(learnply -tracebench).
+
+*/
+
+#pragma once
+#include <math.h>
+#include <cmath>
+#include <vector>
+#include "fieldSampler.h"
+#include "floatSampler.h"
+#include "topology.h"
+
+enum TraceIntegrator
+{
+	TRACE_EULER,
+	TRACE_RK2,					// midpoint rule
+	TRACE_RK4
+};
+
+enum TracePrecision
+{
+	TRACE_DOUBLE,
+	TRACE_FLOAT					// positions and arithmetic in float, whatever the sampler stores
+};
+
+enum TraceStop
+{
+	TRACE_STOP_BOUNDARY,		// only at the mesh boundary, a zero of the field or max_steps
+	TRACE_STOP_SLOW,			// also where the field magnitude is below min_speed
+	TRACE_STOP_SINGULARITY		// also within capture of a singularity in the same quad
+};
+
+struct TraceConfig
+{
+	TraceIntegrator integrator = TRACE_RK2;
+	bool forward = true;
+	TracePrecision precision = TRACE_DOUBLE;
+	bool normalize = true;		// step along the unit field, else along the field itself
+	TraceStop stop = TRACE_STOP_BOUNDARY;
+	double h = 0.1;				// step: arc length if normalize, else time
+	int max_steps = 1000;
+	double min_speed = 0;		// TRACE_STOP_SLOW
+	const std::vector<Singularity>* sings = NULL;	// TRACE_STOP_SINGULARITY, in quad order as extract_singularities finds them
+	double capture = 0.1;		// TRACE_STOP_SINGULARITY
+};
+
+// traces from seed with the instantiation of trace_policy that matches
+// config; the points after the seed are appended to points. Returns the
+// number of steps.
+int trace_streamline(const FieldSampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points);
+
+// the same on the float copy of the field; with TRACE_DOUBLE the stored
+// floats are interpolated in double
+int trace_streamline(const FloatFieldSampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points);
+
+// the same tracing with the configuration tested at every step, always in
+// double precision
+int trace_streamline_generic(const FieldSampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points);
+
+/******************************************************************************
+Normalization policies: the factor the sampled vector is scaled by
+******************************************************************************/
+
+struct UnitSpeed
+{
+	template <class Real> static Real scale(Real speed) { return 1 / speed; }
+};
+
+struct FieldSpeed
+{
+	template <class Real> static Real scale(Real) { return 1; }
+};
+
+/******************************************************************************
+The field seen by an integrator: a quad that follows the sample points,
+the direction and the normalization. Store is the type the sampler keeps
+the field in, double for FieldSampler and float for FloatFieldSampler.
+******************************************************************************/
+
+template <class Real, class Store, int Sign, class Norm>
+struct TraceField
+{
+	const CellIndex* index;
+	const Store *qx1, *qy1, *qx2, *qy2, *inv_w, *inv_h;
+	const Store *f11, *f21, *f12, *f22, *g11, *g21, *g12, *g22;
+	int cell;
+
+	TraceField(const FieldSampler& f) : index(f.index), cell(-1)
+	{
+		bounds(f.index->qx1.data(), f.index->qy1.data(), f.index->qx2.data(), f.index->qy2.data());
+		corners(f);
+	}
+
+	TraceField(const FloatFieldSampler& f) : index(f.index), cell(-1)
+	{
+		bounds(f.qx1.data(), f.qy1.data(), f.qx2.data(), f.qy2.data());
+		corners(f);
+	}
+
+	void bounds(const Store* x1, const Store* y1, const Store* x2, const Store* y2)
+	{
+		qx1 = x1; qy1 = y1; qx2 = x2; qy2 = y2;
+	}
+
+	template <class Sampler> void corners(const Sampler& f)
+	{
+		inv_w = f.inv_w.data(); inv_h = f.inv_h.data();
+		f11 = f.f11.data(); f21 = f.f21.data(); f12 = f.f12.data(); f22 = f.f22.data();
+		g11 = f.g11.data(); g21 = f.g21.data(); g12 = f.g12.data(); g22 = f.g22.data();
+	}
+
+	// moves cell to the quad holding (x,y), trying the current one first;
+	// false off the mesh
+	bool locate(Real x, Real y)
+	{
+		int c = cell;
+		if (c < 0 || x < (Real)qx1[c] || x > (Real)qx2[c] || y < (Real)qy1[c] || y > (Real)qy2[c])
+			cell = index->find_quad_id(x, y);
+		return cell >= 0;
+	}
+
+	// direction vector at (x,y) and the field magnitude there; false off
+	// the mesh or at a zero
+	bool at(Real x, Real y, Real& vx, Real& vy, Real& speed)
+	{
+		if (!locate(x, y))
+			return false;
+		int i = cell;
+		Real wx2 = (x - (Real)qx1[i]) * (Real)inv_w[i], wx1 = ((Real)qx2[i] - x) * (Real)inv_w[i];
+		Real wy2 = (y - (Real)qy1[i]) * (Real)inv_h[i], wy1 = ((Real)qy2[i] - y) * (Real)inv_h[i];
+		vx = wy1 * (wx1 * (Real)f11[i] + wx2 * (Real)f21[i]) + wy2 * (wx1 * (Real)f12[i] + wx2 * (Real)f22[i]);
+		vy = wy1 * (wx1 * (Real)g11[i] + wx2 * (Real)g21[i]) + wy2 * (wx1 * (Real)g12[i] + wx2 * (Real)g22[i]);
+		speed = std::sqrt(vx * vx + vy * vy);
+		if (speed == 0)
+			return false;
+		Real s = Sign * Norm::scale(speed);
+		vx *= s;
+		vy *= s;
+		return true;
+	}
+};
+
+/******************************************************************************
+Integrators: one step from (x,y), written back on success; speed is the
+field magnitude at the start of the step
+******************************************************************************/
+
+struct EulerStep
+{
+	template <class Field, class Real>
+	static bool advance(Field& f, Real h, Real& x, Real& y, Real& speed)
+	{
+		Real vx, vy;
+		if (!f.at(x, y, vx, vy, speed))
+			return false;
+		x += h * vx;
+		y += h * vy;
+		return f.locate(x, y);
+	}
+};
+
+struct MidpointStep
+{
+	template <class Field, class Real>
+	static bool advance(Field& f, Real h, Real& x, Real& y, Real& speed)
+	{
+		Real k0x, k0y, k1x, k1y, s1;
+		if (!f.at(x, y, k0x, k0y, speed) || !f.at(x + Real(0.5) * h * k0x, y + Real(0.5) * h * k0y, k1x, k1y, s1))
+			return false;
+		x += h * k1x;
+		y += h * k1y;
+		return f.locate(x, y);
+	}
+};
+
+struct RK4Step
+{
+	template <class Field, class Real>
+	static bool advance(Field& f, Real h, Real& x, Real& y, Real& speed)
+	{
+		Real k0x, k0y, k1x, k1y, k2x, k2y, k3x, k3y, s;
+		Real half = Real(0.5) * h;
+		if (!f.at(x, y, k0x, k0y, speed) ||
+			!f.at(x + half * k0x, y + half * k0y, k1x, k1y, s) ||
+			!f.at(x + half * k1x, y + half * k1y, k2x, k2y, s) ||
+			!f.at(x + h * k2x, y + h * k2y, k3x, k3y, s))
+			return false;
+		x += h / 6 * (k0x + 2 * k1x + 2 * k2x + k3x);
+		y += h / 6 * (k0y + 2 * k1y + 2 * k2y + k3y);
+		return f.locate(x, y);
+	}
+};
+
+/******************************************************************************
+Termination policies: tested after every step at the new point
+******************************************************************************/
+
+struct StopAtBoundary
+{
+	StopAtBoundary(const TraceConfig&) {}
+	template <class Real> bool operator()(int, Real, Real, Real) { return false; }
+};
+
+struct StopWhenSlow
+{
+	double min_speed;
+	StopWhenSlow(const TraceConfig& config) : min_speed(config.min_speed) {}
+	template <class Real> bool operator()(int, Real, Real, Real speed) { return speed < (Real)min_speed; }
+};
+
+// keeps the range of singularities in the current quad, so the binary
+// search only runs when the streamline enters another quad
+struct StopNearSingularity
+{
+	const std::vector<Singularity>* sings;
+	double capture2;
+	int cell, first, last;
+
+	StopNearSingularity(const TraceConfig& config) :
+		sings(config.sings), capture2(config.capture * config.capture), cell(-1), first(0), last(0) {}
+
+	template <class Real> bool operator()(int c, Real x, Real y, Real)
+	{
+		if (c != cell) {
+			cell = c;
+			first = last = 0;
+			if (sings != NULL) {
+				int lo = 0, hi = (int)sings->size();
+				while (lo < hi) {
+					int mid = (lo + hi) / 2;
+					if ((*sings)[mid].quad < c)
+						lo = mid + 1;
+					else
+						hi = mid;
+				}
+				first = last = lo;
+				while (last < sings->size() && (*sings)[last].quad == c)
+					last++;
+			}
+		}
+		for (int i = first; i < last; i++) {
+			double dx = x - (*sings)[i].pos.x, dy = y - (*sings)[i].pos.y;
+			if (dx * dx + dy * dy < capture2)
+				return true;
+		}
+		return false;
+	}
+};
+
+/******************************************************************************
+The tracer
+******************************************************************************/
+
+template <class Real, class Integrator, int Sign, class Norm, class Stop, class Sampler>
+int trace_policy(const Sampler& field, const icVector2& seed, const TraceConfig& config, std::vector<icVector2>& points)
+{
+	TraceField<Real, typename Sampler::storage_type, Sign, Norm> f(field);
+	Stop stop(config);
+	Real x = (Real)seed.x, y = (Real)seed.y;
+	if (!f.locate(x, y))
+		return 0;
+	Real h = (Real)config.h;
+	int n = 0;
+	for (; n < config.max_steps; n++) {
+		Real nx = x, ny = y, speed;
+		if (!Integrator::advance(f, h, nx, ny, speed) || stop(f.cell, nx, ny, speed))
+			break;
+		x = nx;
+		y = ny;
+		points.push_back(icVector2(x, y));
+	}
+	return n;
+}
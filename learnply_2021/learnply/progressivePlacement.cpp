@@ -0,0 +1,100 @@
+/*
+
+Streamline placement on a background thread
+
+*/
+
+#include "progressivePlacement.h"
+
+ProgressivePlacement::ProgressivePlacement(int capacity) : queue(capacity)
+{
+	engine = NULL;
+	cancelled = false;
+	done = true;
+}
+
+ProgressivePlacement::~ProgressivePlacement()
+{
+	cancel();
+	wait();
+}
+
+void ProgressivePlacement::start(StreamlineEngine* engine_in, const PlacementParams& params)
+{
+	cancel();
+	wait();
+	queue.clear();
+
+	engine = engine_in;
+	cancelled = false;
+	done = false;
+	worker = std::thread(&ProgressivePlacement::run, this, params);
+}
+
+void ProgressivePlacement::cancel()
+{
+	cancelled = true;
+}
+
+void ProgressivePlacement::wait()
+{
+	if (worker.joinable())
+		worker.join();
+}
+
+void ProgressivePlacement::run(PlacementParams params)
+{
+	engine->set_listener(publish, this);
+	engine->run(params);
+	engine->set_listener(NULL, NULL);
+	done = true;
+}
+
+// runs on the worker: copies the new line into the queue, waiting for the
+// drawing thread if the queue is full
+bool ProgressivePlacement::publish(const StreamlineEngine& engine, int line, int tracing, void* user)
+{
+	ProgressivePlacement* self = (ProgressivePlacement*)user;
+
+	PlacedLine* slot;
+	while ((slot = self->queue.begin_push()) == NULL) {
+		if (self->cancelled)
+			return false;
+		std::this_thread::yield();
+	}
+
+	const StreamlineSet& set = engine.streamlines;
+	slot->xy.assign(set.xy.begin() + 2 * set.line_begin(line), set.xy.begin() + 2 * set.line_end(line));
+	slot->seed_index = set.seeds[line];
+	slot->traced = tracing >= 0;
+	if (slot->traced) {
+		slot->sample = engine.tracing_lines.point(engine.tracing_lines.line_begin(tracing));
+		slot->seed = engine.tracing_lines.point(engine.tracing_lines.line_begin(tracing) + 1);
+	}
+	self->queue.end_push();
+	return !self->cancelled;
+}
+
+int ProgressivePlacement::poll(StreamlineSet& lines, StreamlineSet& tracing, std::vector<icVector2>& seeds)
+{
+	int n = 0;
+	for (PlacedLine* item = queue.front(); item != NULL; item = queue.front()) {
+		for (int k = 0; k + 1 < item->xy.size(); k += 2)
+			lines.add_point(item->xy[k], item->xy[k + 1]);
+		lines.end_line(item->seed_index);
+		if (item->traced) {
+			tracing.add_point(item->sample.x, item->sample.y);
+			tracing.add_point(item->seed.x, item->seed.y);
+			tracing.end_line();
+			seeds.push_back(item->seed);
+		}
+		queue.pop();
+		n++;
+	}
+	return n;
+}
+
+bool ProgressivePlacement::finished() const
+{
+	return done && queue.empty();
+}
@@ -0,0 +1,71 @@
+/*
+
+Streamline placement on a background thread
+
+start() runs a StreamlineEngine on a worker thread. Every finished
+streamline is copied into a lock-free queue right away, and the drawing
+thread collects them with poll() between frames, so the first lines show
+up after milliseconds and the window stays responsive while the rest
+are placed. A run ends when the field is covered, when its time budget
+(PlacementParams::time_budget) runs out or when cancel() is called.
+
+*/
+
+#pragma once
+#include <thread>
+#include "spscQueue.h"
+#include "streamlineEngine.h"
+
+class ProgressivePlacement
+{
+public:
+
+	// constructors
+
+	// capacity: streamlines that can wait for poll() before the worker
+	// pauses
+	ProgressivePlacement(int capacity = 256);
+	~ProgressivePlacement();
+
+	// methods
+
+	// cancels a run in progress and starts placing on engine; the engine
+	// must not be touched by other threads until finished()
+	void start(StreamlineEngine* engine, const PlacementParams& params);
+
+	// asks the worker to stop after the streamline it is tracing
+	void cancel();
+
+	// blocks until the worker is done; queued lines can still be polled.
+	// Unless cancel() was called, poll() until finished() first, or the
+	// worker can wait on a full queue forever.
+	void wait();
+
+	// appends the streamlines placed since the last call to lines, and
+	// their sample point -> seed links to tracing and seeds; returns the
+	// number of streamlines moved
+	int poll(StreamlineSet& lines, StreamlineSet& tracing, std::vector<icVector2>& seeds);
+
+	// the worker is done and every line has been polled
+	bool finished() const;
+	bool running() const { return worker.joinable() && !done; }
+
+private:
+
+	struct PlacedLine
+	{
+		std::vector<double> xy;
+		int seed_index;				// index of the seed point in xy
+		bool traced;
+		icVector2 sample, seed;		// the tracing link, if traced
+	};
+
+	SpscQueue<PlacedLine> queue;
+	StreamlineEngine* engine;
+	std::thread worker;
+	std::atomic<bool> cancelled;
+	std::atomic<bool> done;
+
+	static bool publish(const StreamlineEngine& engine, int line, int tracing, void* user);
+	void run(PlacementParams params);
+};
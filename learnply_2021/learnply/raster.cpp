@@ -0,0 +1,277 @@
+/*
+
+A small CPU rasterizer for offscreen rendering
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include "raster.h"
+
+SoftRaster::SoftRaster(int width_in, int height_in)
+{
+	width = width_in;
+	height = height_in;
+	image.assign((size_t)width * height * 3, 255);
+	tx0 = ty0 = tw = th = 0;
+	pixels_per_unit = 1.0;
+	for (int r = 0; r < 3; r++)
+		for (int c = 0; c < 4; c++)
+			m[r][c] = 0;
+}
+
+/******************************************************************************
+Build the mesh-to-window transform. This is the composition of the
+orthographic projection of set_view, the modelview matrix of set_scene
+T(translation, -3) * rotmat^T * S(0.9 / radius) * T(-center) and the
+viewport mapping, with y pointing down.
+******************************************************************************/
+
+void SoftRaster::set_view(const PickView& view, Polyhedron* poly)
+{
+	double aspect = (double)width / (double)height;
+	double half_w, half_h;
+	if (aspect >= 1.0) {
+		half_w = view.radius_factor * view.zoom * aspect;
+		half_h = view.radius_factor * view.zoom;
+	}
+	else {
+		half_w = view.radius_factor * view.zoom;
+		half_h = view.radius_factor * view.zoom / aspect;
+	}
+
+	double s = 0.9 / poly->radius;
+	double center[3] = { poly->center.entry[0], poly->center.entry[1], poly->center.entry[2] };
+	double shift[3] = { view.translation[0], view.translation[1], -3.0 };
+
+	// eye = R * s * (p - center) + shift, with R[r][k] = rotmat[k][r]
+	double eye[3][4];
+	for (int r = 0; r < 3; r++) {
+		eye[r][3] = shift[r];
+		for (int k = 0; k < 3; k++) {
+			eye[r][k] = view.rotmat[k][r] * s;
+			eye[r][3] -= eye[r][k] * center[k];
+		}
+	}
+
+	double ax = width / (2.0 * half_w);
+	double ay = height / (2.0 * half_h);
+	for (int c = 0; c < 4; c++) {
+		m[0][c] = ax * eye[0][c];
+		m[1][c] = -ay * eye[1][c];
+		m[2][c] = -eye[2][c];
+	}
+	m[0][3] += width * 0.5;
+	m[1][3] += height * 0.5;
+	pixels_per_unit = ax * s;
+}
+
+void SoftRaster::project(double x, double y, double z, double w[3]) const
+{
+	for (int r = 0; r < 3; r++)
+		w[r] = m[r][0] * x + m[r][1] * y + m[r][2] * z + m[r][3];
+}
+
+/******************************************************************************
+Tiles
+******************************************************************************/
+
+void SoftRaster::begin_tile(int x0, int y0, int w, int h, float R, float G, float B)
+{
+	tx0 = x0;
+	ty0 = y0;
+	tw = w;
+	th = h;
+	color.resize((size_t)w * h * 3);
+	for (size_t k = 0; k < (size_t)w * h; k++) {
+		color[3 * k] = R;
+		color[3 * k + 1] = G;
+		color[3 * k + 2] = B;
+	}
+	depth.assign((size_t)w * h, FLT_MAX);
+}
+
+void SoftRaster::end_tile()
+{
+	for (int j = 0; j < th; j++)
+		for (int i = 0; i < tw; i++) {
+			const float* c = &color[3 * ((size_t)j * tw + i)];
+			unsigned char* dst = &image[3 * ((size_t)(ty0 + j) * width + tx0 + i)];
+			for (int k = 0; k < 3; k++) {
+				float v = c[k] * 255.0f + 0.5f;
+				dst[k] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+			}
+		}
+}
+
+void SoftRaster::plot(int x, int y, float R, float G, float B)
+{
+	x -= tx0;
+	y -= ty0;
+	if (x < 0 || x >= tw || y < 0 || y >= th)
+		return;
+	float* c = &color[3 * ((size_t)y * tw + x)];
+	c[0] = R;
+	c[1] = G;
+	c[2] = B;
+}
+
+/******************************************************************************
+Triangles, rasterized with edge functions at the pixel centers. Either
+the vertex colors are interpolated or the shader is called with the
+interpolated mesh coordinates.
+******************************************************************************/
+
+void SoftRaster::fill_triangle(const double w[3][3], const float c[3][3], FragmentShader shader, void* user, const double p[3][3])
+{
+	double area = (w[1][0] - w[0][0]) * (w[2][1] - w[0][1]) - (w[2][0] - w[0][0]) * (w[1][1] - w[0][1]);
+	if (fabs(area) < 1e-12)
+		return;
+
+	int xmin = (int)floor(fmin(w[0][0], fmin(w[1][0], w[2][0])));
+	int xmax = (int)ceil(fmax(w[0][0], fmax(w[1][0], w[2][0])));
+	int ymin = (int)floor(fmin(w[0][1], fmin(w[1][1], w[2][1])));
+	int ymax = (int)ceil(fmax(w[0][1], fmax(w[1][1], w[2][1])));
+	xmin = xmin < tx0 ? tx0 : xmin;
+	ymin = ymin < ty0 ? ty0 : ymin;
+	xmax = xmax > tx0 + tw - 1 ? tx0 + tw - 1 : xmax;
+	ymax = ymax > ty0 + th - 1 ? ty0 + th - 1 : ymax;
+
+	for (int y = ymin; y <= ymax; y++)
+		for (int x = xmin; x <= xmax; x++) {
+			double px = x + 0.5, py = y + 0.5;
+			double b0 = ((w[1][0] - px) * (w[2][1] - py) - (w[2][0] - px) * (w[1][1] - py)) / area;
+			double b1 = ((w[2][0] - px) * (w[0][1] - py) - (w[0][0] - px) * (w[2][1] - py)) / area;
+			double b2 = 1.0 - b0 - b1;
+			if (b0 < 0 || b1 < 0 || b2 < 0)
+				continue;
+
+			size_t k = (size_t)(y - ty0) * tw + (x - tx0);
+			float z = (float)(b0 * w[0][2] + b1 * w[1][2] + b2 * w[2][2]);
+			if (z > depth[k])
+				continue;
+			depth[k] = z;
+
+			float* dst = &color[3 * k];
+			if (shader != NULL) {
+				shader(b0 * p[0][0] + b1 * p[1][0] + b2 * p[2][0],
+					b0 * p[0][1] + b1 * p[1][1] + b2 * p[2][1], dst, user);
+			}
+			else {
+				for (int i = 0; i < 3; i++)
+					dst[i] = (float)(b0 * c[0][i] + b1 * c[1][i] + b2 * c[2][i]);
+			}
+		}
+}
+
+void SoftRaster::triangle(const double p[3][3], const float c[3][3])
+{
+	double w[3][3];
+	for (int i = 0; i < 3; i++)
+		project(p[i][0], p[i][1], p[i][2], w[i]);
+	fill_triangle(w, c, NULL, NULL, p);
+}
+
+void SoftRaster::triangle(const double p[3][3], FragmentShader shader, void* user)
+{
+	double w[3][3];
+	for (int i = 0; i < 3; i++)
+		project(p[i][0], p[i][1], p[i][2], w[i]);
+	fill_triangle(w, NULL, shader, user, p);
+}
+
+// the quad is split along the diagonal verts[0]-verts[2]
+void SoftRaster::quad(Quad* q, const float c[4][3])
+{
+	static const int tri[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+	for (int t = 0; t < 2; t++) {
+		double p[3][3];
+		float tc[3][3];
+		for (int i = 0; i < 3; i++) {
+			Vertex* v = q->verts[tri[t][i]];
+			p[i][0] = v->x;
+			p[i][1] = v->y;
+			p[i][2] = v->z;
+			for (int k = 0; k < 3; k++)
+				tc[i][k] = c[tri[t][i]][k];
+		}
+		triangle(p, tc);
+	}
+}
+
+void SoftRaster::quad(Quad* q, FragmentShader shader, void* user)
+{
+	static const int tri[2][3] = { { 0, 1, 2 }, { 0, 2, 3 } };
+	for (int t = 0; t < 2; t++) {
+		double p[3][3];
+		for (int i = 0; i < 3; i++) {
+			Vertex* v = q->verts[tri[t][i]];
+			p[i][0] = v->x;
+			p[i][1] = v->y;
+			p[i][2] = v->z;
+		}
+		triangle(p, shader, user);
+	}
+}
+
+/******************************************************************************
+Lines and dots are drawn over the filled geometry without depth test,
+like the line and dot overlays of the display modes.
+******************************************************************************/
+
+void SoftRaster::line(const icVector3& a, const icVector3& b, float R, float G, float B)
+{
+	double wa[3], wb[3];
+	project(a.x, a.y, a.z, wa);
+	project(b.x, b.y, b.z, wb);
+
+	// skip lines that miss the tile
+	if (fmax(wa[0], wb[0]) < tx0 - 1 || fmin(wa[0], wb[0]) > tx0 + tw + 1 ||
+		fmax(wa[1], wb[1]) < ty0 - 1 || fmin(wa[1], wb[1]) > ty0 + th + 1)
+		return;
+
+	double dx = wb[0] - wa[0], dy = wb[1] - wa[1];
+	int n = (int)ceil(fmax(fabs(dx), fabs(dy)));
+	if (n < 1)
+		n = 1;
+	for (int k = 0; k <= n; k++) {
+		double t = (double)k / n;
+		plot((int)floor(wa[0] + t * dx), (int)floor(wa[1] + t * dy), R, G, B);
+	}
+}
+
+void SoftRaster::polyline(const PolyLine& pl, float R, float G, float B)
+{
+	for (int i = 0; i < pl.size(); i++)
+		line(pl[i].start, pl[i].end, R, G, B);
+}
+
+void SoftRaster::streamlines(const StreamlineSet& set, float R, float G, float B)
+{
+	for (int i = 0; i < set.nlines(); i++)
+		for (int k = set.line_begin(i) + 1; k < set.line_end(i); k++)
+			line(icVector3(set.xy[2 * k - 2], set.xy[2 * k - 1], 0), icVector3(set.xy[2 * k], set.xy[2 * k + 1], 0), R, G, B);
+}
+
+// a lit sphere seen from the front: the brightness follows the z component
+// of the sphere normal
+void SoftRaster::dot(double x, double y, double z, double radius, float R, float G, float B)
+{
+	double w[3];
+	project(x, y, z, w);
+	double r = radius * pixels_per_unit;
+	if (r < 0.5)
+		r = 0.5;
+
+	int xmin = (int)floor(w[0] - r), xmax = (int)ceil(w[0] + r);
+	int ymin = (int)floor(w[1] - r), ymax = (int)ceil(w[1] + r);
+	for (int py = ymin; py <= ymax; py++)
+		for (int px = xmin; px <= xmax; px++) {
+			double ddx = (px + 0.5 - w[0]) / r, ddy = (py + 0.5 - w[1]) / r;
+			double d2 = ddx * ddx + ddy * ddy;
+			if (d2 > 1.0)
+				continue;
+			float shade = (float)(0.3 + 0.7 * sqrt(1.0 - d2));
+			plot(px, py, R * shade, G * shade, B * shade);
+		}
+}
@@ -0,0 +1,71 @@
+/*
+
+A small CPU rasterizer for offscreen rendering
+
+Draws the same primitives as the display modes (filled quads, lines and
+dots) with the same mesh-to-window transform as set_view/set_scene, so
+frames can be produced without a window server or GL context.
+
+Large images are rendered in tiles: every tile gets its own color and
+depth buffer of at most tile_size x tile_size pixels, the primitives are
+replayed for each tile and the tile is copied into the output image.
+
+*/
+
+#pragma once
+#include <vector>
+#include "pick.h"
+#include "polyline.h"
+#include "streamlineSet.h"
+
+// computes the color of a fragment from the mesh coordinates (x,y) it covers
+typedef void (*FragmentShader)(double x, double y, float rgb[3], void* user);
+
+class SoftRaster
+{
+public:
+
+	// fields
+	int width, height;			// size of the full image
+	std::vector<unsigned char> image;	// width*height*3 bytes, rows from top to bottom
+
+	// constructors
+
+	SoftRaster(int width, int height);
+
+	// methods
+
+	// mesh-to-window transform of the given view; the aspect ratio of the
+	// view is taken from the image size
+	void set_view(const PickView& view, Polyhedron* poly);
+
+	// makes the tile [x0,x0+w) x [y0,y0+h) current and clears it
+	void begin_tile(int x0, int y0, int w, int h, float R, float G, float B);
+	// copies the current tile into image
+	void end_tile();
+
+	// primitives, in mesh coordinates
+	void triangle(const double p[3][3], const float c[3][3]);
+	void triangle(const double p[3][3], FragmentShader shader, void* user);
+	void quad(Quad* quad, const float c[4][3]);
+	void quad(Quad* quad, FragmentShader shader, void* user);
+	void line(const icVector3& a, const icVector3& b, float R, float G, float B);
+	void polyline(const PolyLine& pl, float R, float G, float B);
+	void streamlines(const StreamlineSet& set, float R, float G, float B);
+	void dot(double x, double y, double z, double radius, float R, float G, float B);
+
+	// mesh point to window coordinates (x right, y down, z = depth)
+	void project(double x, double y, double z, double w[3]) const;
+
+private:
+
+	double m[3][4];				// mesh to window transform
+	double pixels_per_unit;		// scale of the transform in the xy plane
+
+	int tx0, ty0, tw, th;		// current tile
+	std::vector<float> color;	// tw*th*3
+	std::vector<float> depth;	// tw*th
+
+	void fill_triangle(const double w[3][3], const float c[3][3], FragmentShader shader, void* user, const double p[3][3]);
+	void plot(int x, int y, float R, float G, float B);
+};
@@ -0,0 +1,210 @@
+/*
+
+Batched rendering helpers for learnply
+
+The immediate mode helpers in drawUtil.h set up the GL state and issue a
+glBegin/glEnd pair for every primitive. The classes here keep the geometry
+in vertex arrays instead, so a whole set of primitives costs one set of
+state changes and one draw call.
+
+*/
+
+#include "renderBatch.h"
+
+/******************************************************************************
+Streamline render buffer
+******************************************************************************/
+
+StreamlineRenderBuffer::StreamlineRenderBuffer()
+{
+	vbo = 0;
+	dirty = false;
+}
+
+StreamlineRenderBuffer::~StreamlineRenderBuffer()
+{
+	// the GL context may already be gone when global buffers are destroyed,
+	// so the buffer object is left to the driver
+}
+
+void StreamlineRenderBuffer::clear()
+{
+	verts.clear();
+	first.clear();
+	count.clear();
+	dirty = true;
+}
+
+void StreamlineRenderBuffer::begin_strip(const icVector3& p)
+{
+	first.push_back(nverts());
+	count.push_back(0);
+	add_vertex(p);
+}
+
+void StreamlineRenderBuffer::add_vertex(const icVector3& p)
+{
+	verts.push_back((GLfloat)p.x);
+	verts.push_back((GLfloat)p.y);
+	verts.push_back((GLfloat)p.z);
+	count.back()++;
+}
+
+// Appends the segments of a polyline. Consecutive segments that share an
+// end point are merged into one strip, a gap starts a new strip.
+void StreamlineRenderBuffer::add_polyline(const PolyLine& pl)
+{
+	for (int i = 0; i < pl.size(); i++)
+	{
+		const LineSegment& seg = pl[i];
+		if (i == 0 || seg.start != pl[i - 1].end)
+			begin_strip(seg.start);
+		add_vertex(seg.end);
+	}
+	dirty = true;
+}
+
+void StreamlineRenderBuffer::add_polylines(const std::vector<PolyLine>& pls)
+{
+	for (int i = 0; i < pls.size(); i++)
+		add_polyline(pls[i]);
+}
+
+// every line of the set becomes one strip
+void StreamlineRenderBuffer::add_streamlines(const StreamlineSet& set)
+{
+	verts.reserve(verts.size() + 3 * set.npoints());
+	for (int i = 0; i < set.nlines(); i++)
+	{
+		if (set.line_size(i) < 2)
+			continue;
+		first.push_back(nverts());
+		count.push_back(set.line_size(i));
+		for (int k = set.line_begin(i); k < set.line_end(i); k++) {
+			verts.push_back((GLfloat)set.xy[2 * k]);
+			verts.push_back((GLfloat)set.xy[2 * k + 1]);
+			verts.push_back(0.0f);
+		}
+	}
+	dirty = true;
+}
+
+void StreamlineRenderBuffer::upload()
+{
+	dirty = false;
+
+	// without buffer objects the vertex array is read from client memory
+	if (!GLEW_VERSION_1_5)
+		return;
+
+	if (vbo == 0)
+		glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.empty() ? NULL : &verts[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void StreamlineRenderBuffer::draw(double width, float R, float G, float B, int strips)
+{
+	if (dirty)
+		upload();
+	if (strips < 0 || strips > nstrips())
+		strips = nstrips();
+	if (strips == 0)
+		return;
+
+	glDisable(GL_LIGHTING);
+	glEnable(GL_LINE_SMOOTH);
+	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+	glLineWidth(width);
+	glColor3f(R, G, B);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if (vbo != 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glVertexPointer(3, GL_FLOAT, 0, (const GLvoid*)0);
+	}
+	else {
+		glVertexPointer(3, GL_FLOAT, 0, &verts[0]);
+	}
+
+	if (GLEW_VERSION_1_4)
+		glMultiDrawArrays(GL_LINE_STRIP, &first[0], &count[0], strips);
+	else
+		for (int i = 0; i < strips; i++)
+			glDrawArrays(GL_LINE_STRIP, first[i], count[i]);
+
+	if (vbo != 0)
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+/******************************************************************************
+Dot render batch
+******************************************************************************/
+
+GLuint DotRenderBatch::sphere_list = 0;
+
+GLuint DotRenderBatch::get_sphere_list()
+{
+	if (sphere_list != 0)
+		return sphere_list;
+
+	sphere_list = glGenLists(1);
+	GLUquadric* quadric = gluNewQuadric();
+	glNewList(sphere_list, GL_COMPILE);
+	gluSphere(quadric, 1.0, 16, 16);
+	glEndList();
+	gluDeleteQuadric(quadric);
+	return sphere_list;
+}
+
+void DotRenderBatch::clear()
+{
+	pos.clear();
+	color.clear();
+}
+
+void DotRenderBatch::add_dot(double x, double y, double z, float R, float G, float B)
+{
+	pos.push_back((GLfloat)x);
+	pos.push_back((GLfloat)y);
+	pos.push_back((GLfloat)z);
+	color.push_back(R);
+	color.push_back(G);
+	color.push_back(B);
+}
+
+void DotRenderBatch::draw(double radius, GLenum mode)
+{
+	if (pos.empty())
+		return;
+
+	GLuint list = get_sphere_list();
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glEnable(GL_DEPTH_TEST);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	glShadeModel(GL_SMOOTH);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glEnable(GL_LIGHT1);
+	glColorMaterial(GL_FRONT, GL_DIFFUSE);
+	glEnable(GL_COLOR_MATERIAL);
+	glMatrixMode(GL_MODELVIEW);
+
+	for (int i = 0; i < ndots(); i++)
+	{
+		if (mode == GL_SELECT)
+			glLoadName(i + 1);
+
+		glColor3fv(&color[3 * i]);
+		glPushMatrix();
+		glTranslatef(pos[3 * i], pos[3 * i + 1], pos[3 * i + 2]);
+		glScaled(radius, radius, radius);
+		glCallList(list);
+		glPopMatrix();
+	}
+
+	glDisable(GL_COLOR_MATERIAL);
+}
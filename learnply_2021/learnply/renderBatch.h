@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include "gl/glew.h"
+#include "polyline.h"
+#include "streamlineSet.h"
+
+// Packs many polylines into one vertex array so that a whole set of
+// streamlines can be drawn with a single call.
+// Each connected run of line segments is stored as one line strip;
+// first[i] and count[i] give the offset and the number of vertices of strip i.
+// The vertex data is uploaded to the GPU lazily, the next time draw() is
+// called after the contents changed.
+class StreamlineRenderBuffer
+{
+public:
+
+	// fields
+	std::vector<GLfloat> verts;		// x,y,z of every strip vertex
+	std::vector<GLint> first;		// offset of each strip into verts (in vertices)
+	std::vector<GLsizei> count;		// number of vertices of each strip
+
+	// constructors
+
+	StreamlineRenderBuffer();
+	~StreamlineRenderBuffer();
+
+	// methods
+
+	void clear();
+	void add_polyline(const PolyLine& pl);
+	void add_polylines(const std::vector<PolyLine>& pls);
+	void add_streamlines(const StreamlineSet& set);
+	int nstrips() const { return (int)first.size(); }
+	int nverts() const { return (int)verts.size() / 3; }
+
+	// draws every strip with one set of state changes
+	// width: width of the lines
+	// R, G, B: line color [0,1]
+	// strips: draws only the first strips strips, -1 for all
+	void draw(double width = 1.0, float R = 0.0, float G = 0.0, float B = 0.0, int strips = -1);
+
+private:
+
+	GLuint vbo;
+	bool dirty;		// verts changed since the last upload
+
+	void upload();
+	void begin_strip(const icVector3& p);
+	void add_vertex(const icVector3& p);
+};
+
+// Draws many dots with one shared sphere mesh.
+// The sphere is tessellated once into a display list and every dot only
+// costs a translation and a call of that list; lighting and material state
+// is set up once per batch, the per-dot color is fed through glColorMaterial.
+class DotRenderBatch
+{
+public:
+
+	// fields
+	std::vector<GLfloat> pos;		// x,y,z of every dot
+	std::vector<GLfloat> color;		// R,G,B of every dot
+
+	// methods
+
+	void clear();
+	void add_dot(double x, double y, double z, float R = 0.0, float G = 0.0, float B = 0.0);
+	int ndots() const { return (int)pos.size() / 3; }
+
+	// draws every dot as a sphere
+	// radius: radius of the dots
+	// mode: GL_SELECT loads the name i+1 for dot i so the batch can be used for picking
+	void draw(double radius = 0.15, GLenum mode = GL_RENDER);
+
+private:
+
+	static GLuint sphere_list;	// unit sphere shared by all batches
+	static GLuint get_sphere_list();
+};
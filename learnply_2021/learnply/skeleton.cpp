@@ -0,0 +1,210 @@
+/*
+
+Topological skeleton of the vertex vector field
+
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include "skeleton.h"
+#include "packetTracer.h"
+
+// saddles taken by a worker at a time
+static const int SADDLE_BATCH = 16;
+
+struct SkeletonWork
+{
+	const FieldSampler* field;
+	const SkeletonParams* params;
+	const std::vector<Singularity>* sings;
+	std::vector<int> saddles;			// indices into sings
+
+	// singularity search: one range of quads per thread
+	std::vector<std::vector<Singularity>> found;
+
+	// tracing: every thread keeps the paths it traced in its own set,
+	// paths[4*s+k] = (thread, line) of separatrix k of saddle s
+	std::vector<StreamlineSet> traced;
+	std::vector<std::pair<int, int>> paths;
+	std::vector<int> ends;
+	std::atomic<int> next_saddle;
+};
+
+static void find_worker(SkeletonWork* work, int thread, int nthreads)
+{
+	int n = (int)work->field->f11.size();
+	int first = (int)((long long)n * thread / nthreads);
+	int last = (int)((long long)n * (thread + 1) / nthreads);
+	extract_singularities(*work->field, first, last, work->found[thread], work->params->cache);
+}
+
+// singularity of sings in cell closer than capture to p, or -1; sings are
+// sorted by quad
+static int captured_by(const std::vector<Singularity>& sings, int cell, const icVector2& p, double capture)
+{
+	int lo = 0, hi = (int)sings.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (sings[mid].quad < cell)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (int i = lo; i < sings.size() && sings[i].quad == cell; i++)
+		if (length(p - sings[i].pos) < capture)
+			return i;
+	return -1;
+}
+
+// traces the four separatrices of saddles [first,last) of work->saddles
+// as the lanes of one packet, with fourth order Runge-Kutta steps
+static void trace_packet(SkeletonWork* work, int thread, int first, int last, StreamlinePacket& packet,
+	std::vector<icVector2>* lane_points)
+{
+	const std::vector<Singularity>& sings = *work->sings;
+	const SkeletonParams& params = *work->params;
+	int saddle[PACKET_WIDTH], end[PACKET_WIDTH];
+	bool left_saddle[PACKET_WIDTH], done[PACKET_WIDTH];
+
+	packet.clear();
+	for (int s = first; s < last; s++) {
+		const Singularity& sing = sings[work->saddles[s]];
+		for (int k = 0; k < 4; k++) {
+			// eigvec[0] is the unstable direction, eigvec[1] the stable one
+			bool outgoing = k < 2;
+			icVector2 start = sing.pos + ((k & 1) ? -params.offset : params.offset) * sing.eigvec[outgoing ? 0 : 1];
+			int l = packet.add(start.x, start.y, outgoing ? params.step : -params.step);
+			saddle[l] = work->saddles[s];
+			end[l] = packet.active(l) ? SEPARATRIX_OPEN : SEPARATRIX_BOUNDARY;
+			// the saddle itself only captures a separatrix once it has left it
+			left_saddle[l] = false;
+			done[l] = !packet.active(l);
+			lane_points[l].clear();
+			lane_points[l].push_back(sing.pos);
+			lane_points[l].push_back(start);
+		}
+	}
+
+	int nactive = packet.nlanes;
+	for (int step = 0; step < params.step_max && nactive > 0; step++) {
+		packet.step(PACKET_RK4);
+		nactive = 0;
+		for (int l = 0; l < packet.nlanes; l++) {
+			if (done[l])
+				continue;
+			if (!packet.active(l)) {
+				end[l] = packet.state[l] == LANE_BOUNDARY ? SEPARATRIX_BOUNDARY : SEPARATRIX_OPEN;
+				done[l] = true;
+				continue;
+			}
+			icVector2 p(packet.x[l], packet.y[l]);
+			lane_points[l].push_back(p);
+			if (!left_saddle[l])
+				left_saddle[l] = length(p - sings[saddle[l]].pos) > 2 * params.capture;
+			int sing = captured_by(sings, packet.cell[l], p, params.capture);
+			if (sing >= 0 && (sing != saddle[l] || left_saddle[l])) {
+				lane_points[l].push_back(sings[sing].pos);
+				end[l] = sing;
+				done[l] = true;
+				packet.stop(l);
+				continue;
+			}
+			nactive++;
+		}
+	}
+
+	StreamlineSet& set = work->traced[thread];
+	for (int l = 0; l < packet.nlanes; l++) {
+		int sep = 4 * first + l;
+		work->ends[sep] = end[l];
+		work->paths[sep] = std::make_pair(thread, set.add_line(lane_points[l]));
+	}
+}
+
+static void trace_worker(SkeletonWork* work, int thread)
+{
+	StreamlinePacket packet(work->field);
+	std::vector<icVector2> lane_points[PACKET_WIDTH];
+	const int per_packet = PACKET_WIDTH / 4;
+	int n = (int)work->saddles.size();
+	for (int first = work->next_saddle.fetch_add(SADDLE_BATCH); first < n; first = work->next_saddle.fetch_add(SADDLE_BATCH)) {
+		int last = first + SADDLE_BATCH < n ? first + SADDLE_BATCH : n;
+		for (int s = first; s < last; s += per_packet)
+			trace_packet(work, thread, s, s + per_packet < last ? s + per_packet : last, packet, lane_points);
+	}
+}
+
+void TopologySkeleton::build(const FieldSampler& field, const SkeletonParams& params_in)
+{
+	params = params_in;
+	int nthreads = params.nthreads > 0 ? params.nthreads : (int)std::thread::hardware_concurrency();
+	if (nthreads < 1)
+		nthreads = 1;
+
+	SkeletonWork work;
+	work.field = &field;
+	work.params = &params;
+	work.sings = &sings;
+
+	// singularities, gathered back in quad order
+	work.found.resize(nthreads);
+	std::vector<std::thread> workers;
+	for (int t = 1; t < nthreads; t++)
+		workers.push_back(std::thread(find_worker, &work, t, nthreads));
+	find_worker(&work, 0, nthreads);
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+	workers.clear();
+	sings.clear();
+	for (int t = 0; t < nthreads; t++)
+		sings.insert(sings.end(), work.found[t].begin(), work.found[t].end());
+
+	// separatrices
+	for (int i = 0; i < sings.size(); i++)
+		if (sings[i].type == SING_SADDLE)
+			work.saddles.push_back(i);
+	int nsaddles = (int)work.saddles.size();
+	work.traced.resize(nthreads);
+	work.paths.resize(4 * nsaddles);
+	work.ends.resize(4 * nsaddles);
+	work.next_saddle = 0;
+	int ntracers = std::min(nthreads, (nsaddles + SADDLE_BATCH - 1) / SADDLE_BATCH);
+	for (int t = 1; t < ntracers; t++)
+		workers.push_back(std::thread(trace_worker, &work, t));
+	if (ntracers > 0)
+		trace_worker(&work, 0);
+	for (int t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	separatrices.resize(4 * nsaddles);
+	lines.clear();
+	for (int i = 0; i < 4 * nsaddles; i++) {
+		Separatrix& sep = separatrices[i];
+		sep.saddle = work.saddles[i / 4];
+		sep.outgoing = i % 4 < 2;
+		sep.end = work.ends[i];
+		lines.add_line(work.traced[work.paths[i].first], work.paths[i].second);
+	}
+}
+
+bool TopologySkeleton::write(const char* filename) const
+{
+	FILE* fp = fopen(filename, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Can't open %s for writing\n", filename);
+		return false;
+	}
+	fprintf(fp, "%d\n", (int)sings.size());
+	for (int i = 0; i < sings.size(); i++)
+		fprintf(fp, "%.17g %.17g %d\n", sings[i].pos.x, sings[i].pos.y, (int)sings[i].type);
+	fprintf(fp, "%d\n", (int)separatrices.size());
+	for (int i = 0; i < separatrices.size(); i++)
+		fprintf(fp, "%d %d %d\n", separatrices[i].saddle, separatrices[i].end, separatrices[i].outgoing ? 1 : 0);
+	bool ok = lines.write(fp);
+	if (fclose(fp) != 0)
+		ok = false;
+	return ok;
+}
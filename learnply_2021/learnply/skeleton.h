@@ -0,0 +1,67 @@
+/*
+
+Topological skeleton of the vertex vector field
+
+The singularities are the nodes of a graph whose edges are the
+separatrices of the saddles: the two streamlines leaving a saddle along
+its unstable eigenvector and the two reaching it along its stable one.
+Each separatrix is traced until it comes close to a singularity, leaves
+the mesh or runs out of steps.
+
+Both the search for singularities (split over ranges of quads) and the
+tracing (split over the saddles) run on several threads. Each thread
+traces the separatrices of four saddles at a time in lockstep, as the
+lanes of a StreamlinePacket, which only asks the CellIndex for a quad
+when a front leaves the one it is in.
+
+*/
+
+#pragma once
+#include <vector>
+#include "topology.h"
+#include "streamlineSet.h"
+
+// end of a separatrix that does not reach a singularity
+const int SEPARATRIX_BOUNDARY = -1;		// left the mesh
+const int SEPARATRIX_OPEN = -2;			// ran out of steps or into a zero of the field
+
+struct SkeletonParams
+{
+	double step = 0.05;			// integration step, in mesh units
+	int step_max = 10000;		// upper limit of steps for each separatrix
+	double offset = 0.01;		// separatrices start this far from their saddle along its eigenvectors
+	double capture = 0.1;		// a separatrix ends when it gets this close to a singularity
+	int nthreads = 0;			// 0 for one per hardware thread
+	const CellCache* cache = NULL;	// optional, for the singularity search
+};
+
+struct Separatrix
+{
+	int saddle;			// index into TopologySkeleton::sings
+	bool outgoing;		// traced forward along the unstable eigenvector, else backward along the stable one
+	int end;			// singularity the separatrix ends at, or SEPARATRIX_BOUNDARY or SEPARATRIX_OPEN
+};
+
+class TopologySkeleton
+{
+public:
+
+	// fields
+	SkeletonParams params;					// parameters of the last build
+	std::vector<Singularity> sings;			// nodes, in quad order
+	std::vector<Separatrix> separatrices;	// edges, four per saddle in the order of the saddles
+	StreamlineSet lines;					// the path of every separatrix, from its saddle on
+
+	// methods
+
+	// finds the singularities of field and traces the separatrices of
+	// every saddle, replacing the previous result
+	void build(const FieldSampler& field, const SkeletonParams& params);
+
+	int nsaddles() const { return (int)separatrices.size() / 4; }
+
+	// writes the graph as text: the singularities as "x y type" rows, the
+	// separatrices as "saddle end outgoing" rows, then their paths in the
+	// format of StreamlineSet::write
+	bool write(const char* filename) const;
+};
@@ -0,0 +1,59 @@
+/*
+
+Lock-free single-producer single-consumer ring buffer
+
+One thread fills slots, another empties them; the two only share the
+head and tail counters. Slots are reused, so items that own buffers
+(vectors) keep their capacity and a steady stream allocates nothing.
+
+*/
+
+#pragma once
+#include <vector>
+#include <atomic>
+
+template <class T>
+class SpscQueue
+{
+public:
+
+	// constructors
+
+	SpscQueue(int capacity) : slots(capacity), head(0), tail(0) {}
+
+	// methods
+
+	// producer: the slot to fill next, or NULL if the queue is full;
+	// the item becomes visible to the consumer with end_push()
+	T* begin_push()
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == slots.size())
+			return NULL;
+		return &slots[h % slots.size()];
+	}
+	void end_push() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	// consumer: the oldest item, or NULL if the queue is empty; the slot
+	// is handed back to the producer with pop()
+	T* front()
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (head.load(std::memory_order_acquire) == t)
+			return NULL;
+		return &slots[t % slots.size()];
+	}
+	void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+	bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+	// drops all items; only while neither side is active
+	void clear() { tail.store(head.load()); }
+
+private:
+
+	std::vector<T> slots;
+	// on separate cache lines, so producer and consumer don't share one
+	alignas(64) std::atomic<size_t> head;	// items pushed so far
+	alignas(64) std::atomic<size_t> tail;	// items popped so far
+};
@@ -0,0 +1,1012 @@
+/*
+
+Evenly-spaced streamline placement (Jobard and Lefer 1997)
+
+*/
+
+#include <math.h>
+#include <float.h>
+#include "streamlineEngine.h"
+
+static const int NO_EDGE = -2;
+
+/******************************************************************************
+Find the quads across each side of every quad once, the tracer steps
+from quad to quad through them.
+******************************************************************************/
+
+StreamlineEngine::StreamlineEngine(const FieldSampler* field_in)
+{
+	field = field_in;
+	index = field->index;
+	cache = NULL;
+	steps = 0;
+	candidates = rejected = 0;
+	deferrals = 0;
+	nloop_stops = nslow_stops = nstall_stops = 0;
+	slow_speed = 0;
+	nfixed = 0;
+	next_probe = 0;
+	grid_size = 1.0;
+	grid_nx = grid_ny = 0;
+	listener = NULL;
+	listener_user = NULL;
+	stop_requested = false;
+	completed = true;
+
+	Polyhedron* poly = index->mesh();
+	neighbors.resize(4 * poly->nquads);
+	for (int i = 0; i < poly->nquads; i++) {
+		Quad* quad = poly->qlist[i];
+		double x1 = index->qx1[i], x2 = index->qx2[i];
+		double y1 = index->qy1[i], y2 = index->qy2[i];
+		Vertex* v11 = corner_vertex(quad, x1, y1);
+		Vertex* v21 = corner_vertex(quad, x2, y1);
+		Vertex* v12 = corner_vertex(quad, x1, y2);
+		Vertex* v22 = corner_vertex(quad, x2, y2);
+		Vertex* sides[4][2] = { { v11, v21 }, { v12, v22 }, { v11, v12 }, { v21, v22 } };
+		for (int k = 0; k < 4; k++) {
+			Edge* edge = poly->find_edge(sides[k][0], sides[k][1]);
+			if (edge == NULL) {
+				neighbors[4 * i + k] = NO_EDGE;
+				continue;
+			}
+			Quad* other = poly->other_quad(edge, quad);
+			neighbors[4 * i + k] = other == NULL ? -1 : other->index;
+		}
+	}
+}
+
+/******************************************************************************
+Occupancy grid of the placed streamline points
+******************************************************************************/
+
+void StreamlineEngine::size_grid()
+{
+	grid_size = params.d_sep > 0 ? params.d_sep : 1.0;
+	grid_nx = (int)ceil((index->xmax - index->xmin) / grid_size) + 1;
+	grid_ny = (int)ceil((index->ymax - index->ymin) / grid_size) + 1;
+	// the bins keep their capacity for the next run
+	if (grid.size() < grid_nx * grid_ny) {
+		grid.resize(grid_nx * grid_ny);
+		own_grid.resize(grid_nx * grid_ny);
+	}
+}
+
+static int clamp_bin(double t, int n)
+{
+	int b = (int)floor(t);
+	return b < 0 ? 0 : (b >= n ? n - 1 : b);
+}
+
+void StreamlineEngine::add_to_grid(int first, int last)
+{
+	for (int k = first; k < last; k++) {
+		int bx = clamp_bin((streamlines.xy[2 * k] - index->xmin) / grid_size, grid_nx);
+		int by = clamp_bin((streamlines.xy[2 * k + 1] - index->ymin) / grid_size, grid_ny);
+		grid[by * grid_nx + bx].push_back(k);
+	}
+}
+
+// renumbers the grid entries after streamlines were removed
+void StreamlineEngine::remap_grid(const std::vector<int>& remap)
+{
+	for (int b = 0; b < grid_nx * grid_ny; b++) {
+		std::vector<int>& bin = grid[b];
+		int n = 0;
+		for (int i = 0; i < bin.size(); i++)
+			if (remap[bin[i]] >= 0)
+				bin[n++] = remap[bin[i]];
+		bin.resize(n);
+	}
+}
+
+void StreamlineEngine::clear_own()
+{
+	for (int i = 0; i < own_bins.size(); i++)
+		own_grid[own_bins[i]].clear();
+	own_bins.clear();
+	own_points.clear();
+	own_arc.clear();
+}
+
+void StreamlineEngine::add_own(const icVector2& point, double arc)
+{
+	int bx = clamp_bin((point.x - index->xmin) / grid_size, grid_nx);
+	int by = clamp_bin((point.y - index->ymin) / grid_size, grid_ny);
+	std::vector<int>& bin = own_grid[by * grid_nx + bx];
+	if (bin.empty())
+		own_bins.push_back(by * grid_nx + bx);
+	bin.push_back((int)own_points.size());
+	own_points.push_back(point);
+	own_arc.push_back(arc);
+}
+
+// true if the streamline being traced comes back closer than min_d to
+// itself. Points less than pi*min_d apart along the streamline, half a
+// circle of diameter min_d, are always that close and do not count; the
+// slack keeps whole steps that add up to exactly pi*min_d counting.
+bool StreamlineEngine::near_own(const icVector2& point, double arc, float min_d) const
+{
+	double lag = PI * min_d - 1e-6 * params.step;
+	int bx1 = clamp_bin((point.x - min_d - index->xmin) / grid_size, grid_nx);
+	int bx2 = clamp_bin((point.x + min_d - index->xmin) / grid_size, grid_nx);
+	int by1 = clamp_bin((point.y - min_d - index->ymin) / grid_size, grid_ny);
+	int by2 = clamp_bin((point.y + min_d - index->ymin) / grid_size, grid_ny);
+	for (int by = by1; by <= by2; by++)
+		for (int bx = bx1; bx <= bx2; bx++) {
+			const std::vector<int>& bin = own_grid[by * grid_nx + bx];
+			for (int i = 0; i < bin.size(); i++)
+				if (fabs(arc - own_arc[bin[i]]) >= lag && length(point - own_points[bin[i]]) < min_d)
+					return true;
+		}
+	return false;
+}
+
+// true if some placed streamline point is closer than min_d to point
+bool StreamlineEngine::near_streamline(const icVector2& point, float min_d) const
+{
+	int bx1 = clamp_bin((point.x - min_d - index->xmin) / grid_size, grid_nx);
+	int bx2 = clamp_bin((point.x + min_d - index->xmin) / grid_size, grid_nx);
+	int by1 = clamp_bin((point.y - min_d - index->ymin) / grid_size, grid_ny);
+	int by2 = clamp_bin((point.y + min_d - index->ymin) / grid_size, grid_ny);
+	const double* xy = streamlines.xy.data();
+	for (int by = by1; by <= by2; by++)
+		for (int bx = bx1; bx <= bx2; bx++) {
+			const std::vector<int>& bin = grid[by * grid_nx + bx];
+			for (int i = 0; i < bin.size(); i++) {
+				icVector2 ptemp = icVector2(xy[2 * bin[i]], xy[2 * bin[i] + 1]);
+				float cur_distance = length(point - ptemp);
+				if (cur_distance < min_d)
+					return true;
+			}
+		}
+	return false;
+}
+
+// a seed point is valid if it lies on the mesh (and within margin of the
+// region) and is at least min_d away from every placed streamline
+bool StreamlineEngine::is_seed_point_valid(const icVector2& point, float min_d, double margin) const
+{
+	if (!params.in_region(point.x, point.y, margin))
+		return false;
+	if (index->find_quad_id(point.x, point.y) < 0)
+		return false;
+	return !near_streamline(point, min_d);
+}
+
+double StreamlineEngine::coverage() const
+{
+	double h = 0.5 * params.d_sep;
+	if (h <= 0)
+		return 0;
+	int inside = 0, covered = 0;
+	for (double y = index->ymin + 0.5 * h; y < index->ymax; y += h)
+		for (double x = index->xmin + 0.5 * h; x < index->xmax; x += h) {
+			if (index->find_quad_id(x, y) < 0)
+				continue;
+			inside++;
+			if (near_streamline(icVector2(x, y), 0.6 * params.d_sep))
+				covered++;
+		}
+	return inside == 0 ? 0 : (double)covered / inside;
+}
+
+/******************************************************************************
+Integration
+******************************************************************************/
+
+double StreamlineEngine::sing_prox(const icVector2& pos) const
+{
+	double prox = DBL_MAX;
+	for (int i = 0; i < singularities.size(); i++) {
+		double dist = length(pos - singularities[i]);
+		if (dist < prox)
+			prox = dist;
+	}
+	return prox;
+}
+
+// normalized field direction at pos in quad cell, and the field magnitude
+// in speed; false if there is no quad
+bool StreamlineEngine::direction(int cell, const icVector2& pos, icVector2& vect, double* speed) const
+{
+	if (cell < 0)
+		return false;
+	field->sample_in_cell(cell, pos.x, pos.y, vect);
+	if (speed != NULL)
+		*speed = length(vect);
+	normalize(vect);
+	return true;
+}
+
+// mean magnitude of the corner vectors sets the speed at which streamlines end
+void StreamlineEngine::measure_speed()
+{
+	double sum = 0;
+	int n = (int)field->f11.size();
+	for (int i = 0; i < n; i++)
+		sum += sqrt(field->f11[i] * field->f11[i] + field->g11[i] * field->g11[i]) +
+			sqrt(field->f21[i] * field->f21[i] + field->g21[i] * field->g21[i]) +
+			sqrt(field->f12[i] * field->f12[i] + field->g12[i] * field->g12[i]) +
+			sqrt(field->f22[i] * field->f22[i] + field->g22[i] * field->g22[i]);
+	slow_speed = n > 0 ? params.min_speed * sum / (4 * n) : 0;
+}
+
+// one Euler step from cpos; a step that leaves the quad is cut at the side
+// it crosses. Returns the quad of npos, or -1 when the streamline ends;
+// speed is the field magnitude at cpos.
+int StreamlineEngine::streamline_step(icVector2& cpos, icVector2& npos, int cquad, bool forward, double& speed) const
+{
+	if (params.cell_walk)
+		return cell_step(cpos, npos, cquad, forward, speed);
+
+	double x1 = index->qx1[cquad], x2 = index->qx2[cquad];
+	double y1 = index->qy1[cquad], y2 = index->qy2[cquad];
+	double x0 = cpos.x;
+	double y0 = cpos.y;
+
+	icVector2 vect;
+	direction(cquad, cpos, vect, &speed);
+	if (!forward) { vect *= -1.0; }
+	npos.x = cpos.x + params.step * vect.x;
+	npos.y = cpos.y + params.step * vect.y;
+
+	int nquad = cquad; //guess that the next quad will be the same
+	/*check if npos is outside the current quad*/
+	if (npos.x < x1 || npos.x > x2 || npos.y < y1 || npos.y > y2)
+	{
+		// a side parallel to the step can't be crossed, and its crossing
+		// point would divide by zero
+		int side = -1;
+		if (vect.y != 0) {
+			icVector2 cross_y1 = icVector2(x0 + ((y1 - y0) / vect.y) * vect.x, y1);
+			icVector2 cross_y2 = icVector2(x0 + ((y2 - y0) / vect.y) * vect.x, y2);
+			if (cross_y1.x >= x1 && cross_y1.x <= x2 && dot(vect, cross_y1 - cpos) > 0) {
+				npos = cross_y1;
+				side = 0;
+			}
+			else if (cross_y2.x >= x1 && cross_y2.x <= x2 && dot(vect, cross_y2 - cpos) > 0) {
+				npos = cross_y2;
+				side = 1;
+			}
+		}
+		if (side < 0 && vect.x != 0) {
+			icVector2 cross_x1 = icVector2(x1, y0 + ((x1 - x0) / vect.x) * vect.y);
+			icVector2 cross_x2 = icVector2(x2, y0 + ((x2 - x0) / vect.x) * vect.y);
+			if (cross_x1.y >= y1 && cross_x1.y <= y2 && dot(vect, cross_x1 - cpos) > 0) {
+				npos = cross_x1;
+				side = 2;
+			}
+			else if (cross_x2.y >= y1 && cross_x2.y <= y2 && dot(vect, cross_x2 - cpos) > 0) {
+				npos = cross_x2;
+				side = 3;
+			}
+		}
+
+		// none of the crossing points meets the conditions, or the quads are
+		// not axis aligned: locate npos directly
+		if (side < 0 || neighbors[4 * cquad + side] == NO_EDGE)
+			nquad = index->find_quad_id(npos.x, npos.y);
+		else
+			nquad = neighbors[4 * cquad + side];
+
+		if (sing_prox(npos) < params.step)
+			nquad = -1;
+	}
+	return nquad;
+}
+
+// with cell_walk: one segment of the cell-wise tracer, at most step long,
+// that ends where the streamline leaves the quad
+int StreamlineEngine::cell_step(const icVector2& cpos, icVector2& npos, int cquad, bool forward, double& speed) const
+{
+	CellTraceParams walk;
+	walk.max_length = params.step;
+	walk.cache = cache;
+	int nquad = cell_segment(*field, cquad, cpos, forward, walk, npos, speed);
+	if (nquad == CELL_ZERO)
+		return -1;
+	if (nquad != cquad && sing_prox(npos) < params.step)
+		nquad = -1;
+	return nquad;
+}
+
+// traces from cpos in one direction into points until the streamline leaves
+// the mesh, gets closer than d_test to a placed streamline or reaches step_max
+// steps, or one of the early stops of params ends it
+void StreamlineEngine::trace_half_streamline(icVector2 cpos, int cquad, bool forward, std::vector<icVector2>& points)
+{
+	points.clear();
+	float d_test = (float)params.d_test();
+	int sign = forward ? 1 : -1;
+	int loop_stride = params.step < 0.5 * d_test ? (int)(0.5 * d_test / params.step) : 1;
+	// the stall test compares npos with the last point at least
+	// stall_window steps of arc length back, point_arc[back]
+	double stall_arc = params.stall_window * params.step - 1e-6 * params.step;
+	int back = 0;
+	point_arc.clear();
+	icVector2 npos;
+	double speed;
+	double arc = 0;
+	int step_counter = 0;
+	while (cquad >= 0 && step_counter < params.step_max)
+	{
+		// the whole quad is too slow: every step in it would end here
+		if (cache != NULL && cache->slower_than(cquad, slow_speed)) {
+			nslow_stops++;
+			break;
+		}
+		cquad = streamline_step(cpos, npos, cquad, forward, speed);
+		steps++;
+		arc += length(npos - cpos);
+		if (speed < slow_speed) {
+			nslow_stops++;
+			break;
+		}
+		if (!is_seed_point_valid(npos, d_test, params.region_margin))
+			break;
+		// the loop test runs every loop_stride steps; the streamline moves
+		// at most half of d_test in between
+		if (params.stop_loops && (step_counter + 1) % loop_stride == 0) {
+			if (near_own(npos, sign * arc, d_test)) {
+				nloop_stops++;
+				break;
+			}
+			add_own(npos, sign * arc);
+		}
+		if (params.stall_window > 0) {
+			while (back + 1 < step_counter && point_arc[back + 1] <= arc - stall_arc)
+				back++;
+			if (step_counter > 0 && point_arc[back] <= arc - stall_arc && length(npos - points[back]) < params.step) {
+				nstall_stops++;
+				break;
+			}
+		}
+		cpos = npos;
+		points.push_back(npos);
+		point_arc.push_back(arc);
+		step_counter++;
+	}
+}
+
+// traces a streamline through (x,y) and appends it to streamlines; returns
+// the index of the new line, or -1 if (x,y) is not on the mesh
+int StreamlineEngine::build_streamline(double x, double y)
+{
+	int cquad = index->find_quad_id(x, y);
+	if (cquad < 0)
+		return -1;
+
+	// both halves are only tested against the streamlines placed before this
+	// one, and with stop_loops against the seed and the forward half
+	clear_own();
+	add_own(icVector2(x, y), 0);
+	trace_half_streamline(icVector2(x, y), cquad, true, forward_points);
+	trace_half_streamline(icVector2(x, y), cquad, false, backward_points);
+	clear_own();
+
+	// store the line in order: backward half reversed, seed, forward half
+	int first = streamlines.npoints();
+	for (int i = (int)backward_points.size() - 1; i >= 0; --i)
+		streamlines.add_point(backward_points[i].x, backward_points[i].y);
+	streamlines.add_point(x, y);
+	for (int i = 0; i < forward_points.size(); ++i)
+		streamlines.add_point(forward_points[i].x, forward_points[i].y);
+	add_to_grid(first, streamlines.npoints());
+	return streamlines.end_line((int)backward_points.size());
+}
+
+// takes the last streamline back out; its points are the last ones added
+// to their bins
+void StreamlineEngine::drop_last_line()
+{
+	int line = streamlines.nlines() - 1;
+	for (int k = streamlines.line_end(line) - 1; k >= streamlines.line_begin(line); k--) {
+		int bx = clamp_bin((streamlines.xy[2 * k] - index->xmin) / grid_size, grid_nx);
+		int by = clamp_bin((streamlines.xy[2 * k + 1] - index->ymin) / grid_size, grid_ny);
+		grid[by * grid_nx + bx].pop_back();
+	}
+	streamlines.pop_line();
+}
+
+double StreamlineEngine::arc_length(int line) const
+{
+	double len = 0;
+	for (int k = streamlines.line_begin(line) + 1; k < streamlines.line_end(line); k++)
+		len += length(streamlines.point(k) - streamlines.point(k - 1));
+	return len;
+}
+
+/******************************************************************************
+Seeding
+******************************************************************************/
+
+// candidate seed at distance d_sep on the +90 degree side of (vx,vy)
+static icVector2 select_candidate_seed_point_clockwise(const float x, const float y, const float vx, const float vy, const float d_sep) {
+	float new_vx = -vy;
+	float new_vy = vx;
+	float temp = sqrt(vy * vy + vx * vx); //distance
+	temp = temp / d_sep; // get ratio
+	new_vx /= temp;
+	new_vy /= temp;
+	return icVector2(x - new_vx, y - new_vy);
+}
+
+// candidate seed at distance d_sep on the -90 degree side of (vx,vy)
+static icVector2 select_candidate_seed_point_counterclockwise(const float x, const float y, const float vx, const float vy, const float d_sep) {
+	float new_vx = vy;
+	float new_vy = -vx;
+	float temp = sqrt(vy * vy + vx * vx); //distance
+	temp = temp / d_sep; // get ratio
+	new_vx /= temp;
+	new_vy /= temp;
+	return icVector2(x - new_vx, y - new_vy);
+}
+
+// appends the points of line from its seed point k0 in steps of dk to
+// samples, one every spacing of arc length; the points between two
+// streamline points are interpolated on the segment
+static void sample_half(const StreamlineSet& set, int k0, int k1, int dk, double spacing, std::vector<icVector2>& samples)
+{
+	double next = spacing;		// arc length of the next sample
+	double arc = 0;
+	for (int k = k0; k != k1; k += dk) {
+		icVector2 a = set.point(k), b = set.point(k + dk);
+		double len = length(b - a);
+		while (len > 0 && next <= arc + len) {
+			double t = (next - arc) / len;
+			samples.push_back(a + t * (b - a));
+			next += spacing;
+		}
+		arc += len;
+	}
+}
+
+// points of line spacing apart along it, every point for spacing 0, in
+// tracing order: the seed, the forward half, then the backward half
+void StreamlineEngine::sample_line(int line, double spacing)
+{
+	samples.clear();
+	int b = streamlines.line_begin(line);
+	int s = b + streamlines.seeds[line];
+	int e = streamlines.line_end(line);
+	if (spacing <= 0) {
+		for (int k = s; k < e; k++)
+			samples.push_back(streamlines.point(k));
+		for (int k = s - 1; k >= b; k--)
+			samples.push_back(streamlines.point(k));
+		return;
+	}
+	samples.push_back(streamlines.point(s));
+	sample_half(streamlines, s, e - 1, 1, spacing, samples);
+	sample_half(streamlines, s, b, -1, spacing, samples);
+}
+
+// tries both candidate seeds next to every sample point of line
+void StreamlineEngine::seed_from(int line)
+{
+	float d_sep = (float)params.d_sep;
+	sample_line(line, params.seed_spacing * params.d_sep);
+
+	// field directions at all the sample points in one batch
+	int n = (int)samples.size();
+	batch_cells.resize(n);
+	batch_x.resize(n); batch_y.resize(n);
+	batch_vx.resize(n); batch_vy.resize(n);
+	for (int i = 0; i < n; i++) {
+		batch_x[i] = samples[i].x;
+		batch_y[i] = samples[i].y;
+		batch_cells[i] = index->find_quad_id(samples[i].x, samples[i].y);
+	}
+	field->sample_batch(n, batch_cells.data(), batch_x.data(), batch_y.data(), batch_vx.data(), batch_vy.data(), true);
+
+	for (int i = 0; i < n; ++i) {
+		if (batch_cells[i] < 0)
+			continue;
+		icVector2 point = samples[i];
+		icVector2 vet(batch_vx[i], batch_vy[i]);
+
+		for (int side = 0; side < 2; side++) {
+			icVector2 candidate = side == 0 ?
+				select_candidate_seed_point_clockwise(point.x, point.y, vet.x, vet.y, d_sep) :
+				select_candidate_seed_point_counterclockwise(point.x, point.y, vet.x, vet.y, d_sep);
+			candidates++;
+			if (!is_seed_point_valid(candidate, d_sep)) {
+				rejected++;
+				continue;
+			}
+
+			int new_line = build_streamline(candidate.x, candidate.y);
+			if (new_line >= 0 && params.order == SEED_LONGEST_FIRST && arc_length(new_line) < params.defer_length * params.d_sep) {
+				drop_last_line();
+				deferred.push(candidate);
+				deferrals++;
+				continue;
+			}
+			if (new_line >= 0)
+				push_line(new_line);
+
+			int tracing = -1;
+			if (params.trace) {
+				tracing_points.push_back(candidate);
+				tracing_lines.add_point(point.x, point.y);
+				tracing_lines.add_point(candidate.x, candidate.y);
+				tracing = tracing_lines.end_line();
+			}
+
+			if (new_line >= 0 && listener != NULL && !listener(*this, new_line, tracing, listener_user))
+				stop_requested = true;
+			if (should_stop())
+				return;
+		}
+	}
+}
+
+/******************************************************************************
+Place streamlines: trace one from the initial seed, then seed new
+streamlines next to each queued streamline until the queue runs empty.
+******************************************************************************/
+
+void StreamlineEngine::set_listener(StreamlineListener listener_in, void* user)
+{
+	listener = listener_in;
+	listener_user = user;
+}
+
+bool StreamlineEngine::should_stop() const
+{
+	if (stop_requested)
+		return true;
+	return params.time_budget > 0 && std::chrono::steady_clock::now() >= deadline;
+}
+
+void StreamlineEngine::push_line(int line)
+{
+	if (params.order == SEED_LONGEST_FIRST)
+		longest.push(std::make_pair(streamlines.line_size(line), -line));
+	else
+		queue.push(line);
+}
+
+void StreamlineEngine::clear_queues()
+{
+	while (!queue.empty())
+		queue.pop();
+	while (!longest.empty())
+		longest.pop();
+	while (!deferred.empty())
+		deferred.pop();
+}
+
+void StreamlineEngine::reset()
+{
+	streamlines.clear();
+	tracing_lines.clear();
+	tracing_points.clear();
+	other_seeds.clear();
+	clear_queues();
+	forward_points.clear();
+	backward_points.clear();
+	nfixed = 0;
+	next_probe = 0;
+	for (int b = 0; b < grid.size(); b++)
+		grid[b].clear();
+	clear_own();
+	steps = 0;
+	candidates = rejected = 0;
+	deferrals = 0;
+	nloop_stops = nslow_stops = nstall_stops = 0;
+}
+
+size_t StreamlineEngine::memory_bytes() const
+{
+	size_t bytes = streamlines.memory_bytes() + tracing_lines.memory_bytes();
+	bytes += (tracing_points.capacity() + other_seeds.capacity() + forward_points.capacity() + backward_points.capacity() + samples.capacity()) * sizeof(icVector2);
+	bytes += batch_cells.capacity() * sizeof(int) +
+		(batch_x.capacity() + batch_y.capacity() + batch_vx.capacity() + batch_vy.capacity()) * sizeof(double);
+	bytes += neighbors.capacity() * sizeof(int) + singularities.capacity() * sizeof(icVector2) + critical_points.capacity() * sizeof(Singularity);
+	for (int b = 0; b < grid.size(); b++)
+		bytes += (grid[b].capacity() + own_grid[b].capacity()) * sizeof(int);
+	bytes += own_bins.capacity() * sizeof(int) + own_points.capacity() * sizeof(icVector2) + own_arc.capacity() * sizeof(double) + point_arc.capacity() * sizeof(double);
+	bytes += delaunay.points.capacity() * sizeof(icVector2) + delaunay.tris.capacity() * sizeof(DelaunayTriangle);
+	return bytes + (grid.capacity() + own_grid.capacity()) * sizeof(std::vector<int>);
+}
+
+// copies the runs of fixed points near the region as separate lines and
+// queues them for seeding
+void StreamlineEngine::copy_fixed(const StreamlineSet& fixed)
+{
+	double near = params.region_margin + params.d_sep;
+	for (int i = 0; i < fixed.nlines(); i++) {
+		int first = streamlines.npoints();
+		for (int k = fixed.line_begin(i); k <= fixed.line_end(i); k++) {
+			if (k < fixed.line_end(i) && params.in_region(fixed.xy[2 * k], fixed.xy[2 * k + 1], near)) {
+				streamlines.add_point(fixed.xy[2 * k], fixed.xy[2 * k + 1]);
+				continue;
+			}
+			if (streamlines.npoints() > first) {
+				add_to_grid(first, streamlines.npoints());
+				push_line(streamlines.end_line());
+				first = streamlines.npoints();
+			}
+		}
+	}
+	nfixed = streamlines.nlines();
+}
+
+// starts a streamline at the next probe of a d_sep grid over the region
+// that is far enough from the placed ones; -1 once every probe was tried
+int StreamlineEngine::seed_gap()
+{
+	double h = params.d_sep;
+	int nx = (int)floor((params.region_x2 - params.region_x1) / h) + 1;
+	int ny = (int)floor((params.region_y2 - params.region_y1) / h) + 1;
+	for (; next_probe < nx * ny; next_probe++) {
+		icVector2 probe(params.region_x1 + (next_probe % nx + 0.5) * h, params.region_y1 + (next_probe / nx + 0.5) * h);
+		if (!is_seed_point_valid(probe, (float)params.d_sep))
+			continue;
+		int line = build_streamline(probe.x, probe.y);
+		if (line >= 0) {
+			next_probe++;
+			return line;
+		}
+	}
+	return -1;
+}
+
+// traces the put off seeds that are still valid, whatever the length of
+// their streamline; -1 once they are used up
+int StreamlineEngine::next_deferred()
+{
+	while (!deferred.empty()) {
+		icVector2 seed = deferred.front();
+		deferred.pop();
+		if (!is_seed_point_valid(seed, (float)params.d_sep))
+			continue;
+		int line = build_streamline(seed.x, seed.y);
+		if (line >= 0)
+			return line;
+	}
+	return -1;
+}
+
+// the next streamline to seed from: the oldest (or longest) queued one,
+// then one from a put off seed, or in a restricted run a new one started
+// in a gap
+int StreamlineEngine::next_line()
+{
+	if (!queue.empty()) {
+		int line = queue.front();
+		queue.pop();
+		return line;
+	}
+	if (!longest.empty()) {
+		int line = -longest.top().second;
+		longest.pop();
+		return line;
+	}
+	int line = next_deferred();
+	if (line < 0 && params.restrict_region)
+		line = seed_gap();
+	if (line >= 0 && listener != NULL && !listener(*this, line, -1, listener_user))
+		stop_requested = true;
+	return line;
+}
+
+// streamlines stop next to the singularities found by find_singularities
+void StreamlineEngine::load_singularities()
+{
+	Polyhedron* poly = index->mesh();
+	singularities.clear();
+	for (int i = 0; i < poly->nquads; i++)
+		if (poly->qlist[i]->singularity != NULL)
+			singularities.push_back(*poly->qlist[i]->singularity);
+}
+
+// seeds from current and every line queued after it
+void StreamlineEngine::place_from(int current)
+{
+	while (current >= 0) {
+		if (should_stop())
+			return;
+		seed_from(current);
+		current = next_line();
+	}
+	completed = true;
+}
+
+/******************************************************************************
+Topology-guided seeding (after Verma et al. 2000): seed templates around
+the singularities are traced before any other seed, so the flow around
+them is captured by streamlines that start where it is most structured.
+******************************************************************************/
+
+// seeds placed around sing: d_sep along both ways of each eigenvector of a
+// saddle, a ray of seeds d_sep apart out of a centre, and a ring of seeds
+// around sources, sinks and foci wide enough that the streamlines they
+// start do not reject each other's seeds
+static void seed_template(const Singularity& sing, double d_sep, double max_r, std::vector<icVector2>& seeds)
+{
+	seeds.clear();
+	switch (sing.type) {
+	case SING_SADDLE:
+		for (int k = 0; k < 2; k++) {
+			seeds.push_back(sing.pos + d_sep * sing.eigvec[k]);
+			seeds.push_back(sing.pos - d_sep * sing.eigvec[k]);
+		}
+		break;
+	case SING_CENTER:
+		for (double r = d_sep; r < max_r; r += d_sep)
+			seeds.push_back(sing.pos + icVector2(r, 0));
+		break;
+	default:
+	{
+		const int n = 8;
+		double r = 1.05 * d_sep / sin(2 * PI / n);
+		for (int i = 0; i < n; i++)
+			seeds.push_back(sing.pos + r * icVector2(cos(2 * PI * i / n), sin(2 * PI * i / n)));
+		break;
+	}
+	}
+}
+
+// traces the templates of every singularity, saddles first since their
+// separatrices bound the regions of like flow; the streamlines are queued
+// like any other
+void StreamlineEngine::seed_topology()
+{
+	static const SingularityType order[] = { SING_SADDLE, SING_CENTER, SING_REPELLING_FOCUS, SING_ATTRACTING_FOCUS, SING_SOURCE, SING_SINK };
+	float d_sep = (float)params.d_sep;
+	double max_r = (index->xmax - index->xmin) + (index->ymax - index->ymin);
+	extract_singularities(*field, critical_points, cache);
+	for (int o = 0; o < sizeof(order) / sizeof(order[0]); o++)
+		for (int i = 0; i < critical_points.size(); i++) {
+			if (critical_points[i].type != order[o])
+				continue;
+			seed_template(critical_points[i], params.d_sep, max_r, samples);
+			for (int k = 0; k < samples.size(); k++) {
+				if (should_stop())
+					return;
+				candidates++;
+				if (!is_seed_point_valid(samples[k], d_sep)) {
+					rejected++;
+					continue;
+				}
+				int line = build_streamline(samples[k].x, samples[k].y);
+				if (line < 0)
+					continue;
+				push_line(line);
+				if (params.trace)
+					other_seeds.push_back(samples[k]);
+				if (listener != NULL && !listener(*this, line, -1, listener_user))
+					stop_requested = true;
+			}
+		}
+}
+
+void StreamlineEngine::run(const PlacementParams& params_in, const StreamlineSet* fixed)
+{
+	reset();
+	params = params_in;
+	size_grid();
+	stop_requested = false;
+	completed = false;
+	deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((long long)(params.time_budget * 1e6));
+	load_singularities();
+	measure_speed();
+
+	if (fixed != NULL)
+		copy_fixed(*fixed);
+
+	if (params.topology_seeds)
+		seed_topology();
+
+	// the initial seed is only traced if the templates placed nothing, and
+	// only has to be valid when there are fixed streamlines
+	int current = -1;
+	bool templated = streamlines.nlines() > nfixed;
+	if (!templated && (nfixed == 0 || is_seed_point_valid(icVector2(params.seed_x, params.seed_y), (float)params.d_sep)))
+		current = build_streamline(params.seed_x, params.seed_y);
+	if (current >= 0 && listener != NULL && !listener(*this, current, -1, listener_user))
+		stop_requested = true;
+	if (params.order == SEED_FARTHEST_POINT) {
+		place_farthest();
+		return;
+	}
+	if (current < 0)
+		current = next_line();
+	place_from(current);
+}
+
+/******************************************************************************
+Farthest point seeding (Mebarki et al. 2005): the streamline points are
+kept in a Delaunay triangulation, the largest circumcircle is the largest
+circle that holds no streamline point and its centre is the next seed.
+No candidate has to be tested next to every point of every streamline.
+******************************************************************************/
+
+// adds the points of line, d_test apart, to the triangulation; only the
+// circles that can hold a seed are queued
+void StreamlineEngine::insert_line(int line)
+{
+	double r2_min = params.d_sep * params.d_sep;
+	sample_line(line, params.d_test());
+	for (int i = 0; i < samples.size(); i++) {
+		if (!delaunay.insert(samples[i], created))
+			continue;
+		for (int k = 0; k < created.size(); k++) {
+			const DelaunayTriangle& tri = delaunay.tris[created[k]];
+			if (tri.r2 >= r2_min)
+				circles.push(std::make_pair(tri.r2, std::make_pair(created[k], tri.serial)));
+		}
+	}
+}
+
+// traces a streamline from the centre of the largest empty circle that is
+// a valid seed; -1 once every circle left is smaller than d_sep
+int StreamlineEngine::farthest_seed()
+{
+	float d_sep = (float)params.d_sep;
+	// centres outside the mesh bounds are moved onto them
+	double ex = 1e-9 * (index->xmax - index->xmin), ey = 1e-9 * (index->ymax - index->ymin);
+	while (!circles.empty() && circles.top().first >= params.d_sep * params.d_sep) {
+		int t = circles.top().second.first;
+		int serial = circles.top().second.second;
+		circles.pop();
+		if (!delaunay.alive(t) || delaunay.tris[t].serial != serial)
+			continue;
+		const DelaunayTriangle& tri = delaunay.tris[t];
+		icVector2 seed(fmin(fmax(tri.cx, index->xmin + ex), index->xmax - ex), fmin(fmax(tri.cy, index->ymin + ey), index->ymax - ey));
+		candidates++;
+		if (!is_seed_point_valid(seed, d_sep)) {
+			rejected++;
+			continue;
+		}
+		int line = build_streamline(seed.x, seed.y);
+		if (line < 0)
+			continue;
+		if (params.trace)
+			other_seeds.push_back(seed);
+		return line;
+	}
+	return -1;
+}
+
+void StreamlineEngine::place_farthest()
+{
+	double w = index->xmax - index->xmin, h = index->ymax - index->ymin;
+	delaunay.reset(index->xmin - w, index->ymin - h, index->xmax + w, index->ymax + h);
+	while (!circles.empty())
+		circles.pop();
+	for (int l = 0; l < streamlines.nlines(); l++)
+		insert_line(l);
+
+	while (!should_stop()) {
+		int line = farthest_seed();
+		if (line < 0) {
+			completed = true;
+			return;
+		}
+		if (listener != NULL && !listener(*this, line, -1, listener_user))
+			stop_requested = true;
+		insert_line(line);
+	}
+}
+
+/******************************************************************************
+Incremental update after the field was edited: drop the streamlines
+through the edited quads and seed the space they leave from the
+streamlines around it.
+******************************************************************************/
+
+// true if line has a point, or the middle of a segment, in a flagged quad
+static bool crosses(const CellIndex* index, const StreamlineSet& set, int line, const std::vector<char>& flagged)
+{
+	for (int k = set.line_begin(line); k < set.line_end(line); k++) {
+		int cell = index->find_quad_id(set.xy[2 * k], set.xy[2 * k + 1]);
+		if (cell >= 0 && flagged[cell])
+			return true;
+		if (k == set.line_begin(line))
+			continue;
+		cell = index->find_quad_id(0.5 * (set.xy[2 * k - 2] + set.xy[2 * k]), 0.5 * (set.xy[2 * k - 1] + set.xy[2 * k + 1]));
+		if (cell >= 0 && flagged[cell])
+			return true;
+	}
+	return false;
+}
+
+int StreamlineEngine::update(const std::vector<int>& dirty_quads)
+{
+	if (dirty_quads.empty())
+		return 0;
+
+	// bounds of the edited quads and of the streamlines through them
+	std::vector<char> dirty(index->mesh()->nquads, 0);
+	double x1 = DBL_MAX, y1 = DBL_MAX, x2 = -DBL_MAX, y2 = -DBL_MAX;
+	for (int i = 0; i < dirty_quads.size(); i++) {
+		int q = dirty_quads[i];
+		dirty[q] = 1;
+		x1 = fmin(x1, index->qx1[q]);
+		y1 = fmin(y1, index->qy1[q]);
+		x2 = fmax(x2, index->qx2[q]);
+		y2 = fmax(y2, index->qy2[q]);
+	}
+	std::vector<char> removed(streamlines.nlines(), 0);
+	int nremoved = 0, nfixed_removed = 0;
+	for (int l = 0; l < streamlines.nlines(); l++) {
+		if (!crosses(index, streamlines, l, dirty))
+			continue;
+		removed[l] = 1;
+		nremoved++;
+		if (l < nfixed)
+			nfixed_removed++;
+		for (int k = streamlines.line_begin(l); k < streamlines.line_end(l); k++) {
+			x1 = fmin(x1, streamlines.xy[2 * k]);
+			y1 = fmin(y1, streamlines.xy[2 * k + 1]);
+			x2 = fmax(x2, streamlines.xy[2 * k]);
+			y2 = fmax(y2, streamlines.xy[2 * k + 1]);
+		}
+	}
+
+	std::vector<int> remap;
+	streamlines.remove_lines(removed, remap);
+	remap_grid(remap);
+	nfixed -= nfixed_removed;
+
+	// seeds are only taken inside the freed space; the new streamlines run
+	// as far as the kept ones let them
+	PlacementParams saved = params;
+	params.restrict_region = true;
+	params.region_x1 = x1 - params.d_sep;
+	params.region_y1 = y1 - params.d_sep;
+	params.region_x2 = x2 + params.d_sep;
+	params.region_y2 = y2 + params.d_sep;
+	params.region_margin = (index->xmax - index->xmin) + (index->ymax - index->ymin);
+
+	// the sample point -> seed links of the freed space are traced again
+	std::vector<char> stale(tracing_lines.nlines(), 0);
+	for (int i = 0; i < tracing_lines.nlines(); i++) {
+		icVector2 seed = tracing_lines.point(tracing_lines.line_begin(i) + 1);
+		stale[i] = params.in_region(seed.x, seed.y);
+	}
+	tracing_lines.remove_lines(stale, remap);
+	int n = 0;
+	for (int i = 0; i < stale.size(); i++)
+		if (!stale[i])
+			tracing_points[n++] = tracing_points[i];
+	tracing_points.resize(n);
+	n = 0;
+	for (int i = 0; i < other_seeds.size(); i++)
+		if (!params.in_region(other_seeds[i].x, other_seeds[i].y))
+			other_seeds[n++] = other_seeds[i];
+	other_seeds.resize(n);
+
+	clear_queues();
+	for (int l = 0; l < streamlines.nlines(); l++)
+		for (int k = streamlines.line_begin(l); k < streamlines.line_end(l); k++)
+			if (params.in_region(streamlines.xy[2 * k], streamlines.xy[2 * k + 1], params.d_sep)) {
+				push_line(l);
+				break;
+			}
+
+	steps = 0;
+	candidates = rejected = 0;
+	deferrals = 0;
+	nloop_stops = nslow_stops = nstall_stops = 0;
+	next_probe = 0;
+	stop_requested = false;
+	completed = false;
+	deadline = std::chrono::steady_clock::now() + std::chrono::microseconds((long long)(params.time_budget * 1e6));
+	load_singularities();
+	measure_speed();
+	if (params.topology_seeds)
+		seed_topology();
+	if (params.order == SEED_FARTHEST_POINT)
+		place_farthest();
+	else
+		place_from(next_line());
+
+	params = saved;
+	return nremoved;
+}
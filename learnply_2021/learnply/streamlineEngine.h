@@ -0,0 +1,243 @@
+/*
+
+Evenly-spaced streamline placement (Jobard and Lefer 1997)
+
+The placement parameters are passed in at run time and every engine
+keeps its own streamlines, queue and occupancy grid, so several engines
+can place streamlines on the same mesh at the same time. The mesh, its
+CellIndex and FieldSampler are only read. An engine is reused from run
+to run: each run starts from an empty result but keeps the buffers.
+
+*/
+
+#pragma once
+#include <vector>
+#include <queue>
+#include <chrono>
+#include "fieldSampler.h"
+#include "streamlineSet.h"
+#include "delaunay.h"
+#include "topology.h"
+#include "cellTracer.h"
+
+// how new seeds are found
+enum SeedOrder
+{
+	SEED_FIFO,				// next to the placed streamlines, oldest streamline first (Jobard and Lefer)
+	SEED_LONGEST_FIRST,		// the same, longest streamline first; short ones are put off until no long one is left (Liu et al. 2006)
+	SEED_FARTHEST_POINT		// at the centre of the largest empty circle among the streamline points (Mebarki et al. 2005)
+};
+
+struct PlacementParams
+{
+	double step = 0.1;			// integration step, in mesh units
+	int step_max = 1000;		// upper limit of steps for each half of a streamline
+	double d_sep = 0.8;			// distance between a streamline and the seeds placed next to it
+	double d_test_ratio = 0.5;	// streamlines stop at d_test = d_test_ratio * d_sep from other streamlines
+	double seed_spacing = 0;	// arc length between the points candidate seeds are taken next to, as a fraction of d_sep; 0 for every integration point
+	SeedOrder order = SEED_FIFO;
+	double defer_length = 2;	// with SEED_LONGEST_FIRST, streamlines shorter than defer_length * d_sep wait in the second queue
+	double seed_x = 0;			// seed of the first streamline
+	double seed_y = 0;
+	bool topology_seeds = false;	// first seed templates around the classified singularities, then as order says
+	bool cell_walk = false;		// trace with cell-wise segments of at most step (cellTracer.h) instead of Euler steps cut at the quad sides
+	bool trace = true;			// record the sample point -> seed links shown in display mode 6
+	double time_budget = 0;		// seconds a run may take, 0 for no limit
+
+	// streamlines that stop making progress end early
+	bool stop_loops = true;		// a streamline comes back within d_test of itself, more than pi*d_test of arc length away
+	double min_speed = 1e-3;	// field magnitude, relative to the mean over the mesh, below which a streamline ends
+	int stall_window = 16;		// a streamline ends if it moves less than one step over this many steps of arc length, 0 to disable
+
+	// seeds stay inside [region_x1,region_x2] x [region_y1,region_y2],
+	// streamlines end region_margin beyond it
+	bool restrict_region = false;
+	double region_x1 = 0, region_y1 = 0, region_x2 = 0, region_y2 = 0;
+	double region_margin = 0;
+
+	double d_test() const { return d_sep * d_test_ratio; }
+	bool in_region(double x, double y, double margin = 0) const
+	{
+		return !restrict_region || (x >= region_x1 - margin && x <= region_x2 + margin && y >= region_y1 - margin && y <= region_y2 + margin);
+	}
+	// true if p places the same streamlines from the same seed; the seed,
+	// the region, trace and time_budget are not compared
+	bool same_placement(const PlacementParams& p) const
+	{
+		return step == p.step && step_max == p.step_max && d_sep == p.d_sep && d_test_ratio == p.d_test_ratio &&
+			seed_spacing == p.seed_spacing && order == p.order && defer_length == p.defer_length &&
+			topology_seeds == p.topology_seeds && cell_walk == p.cell_walk &&
+			stop_loops == p.stop_loops && min_speed == p.min_speed && stall_window == p.stall_window;
+	}
+};
+
+class StreamlineEngine;
+
+// called by a running engine after each new streamline; tracing is the
+// index of its sample point -> seed link in tracing_lines, or -1.
+// Returning false stops the run.
+typedef bool (*StreamlineListener)(const StreamlineEngine& engine, int line, int tracing, void* user);
+
+class StreamlineEngine
+{
+public:
+
+	// fields
+	PlacementParams params;				// parameters of the last run
+	StreamlineSet streamlines;			// result of the last run
+	StreamlineSet tracing_lines;		// one two-point line from each sample point to the seed it produced
+	std::vector<icVector2> tracing_points;	// seeds that produced a streamline, one per link of tracing_lines
+	std::vector<icVector2> other_seeds;		// seeds that produced a streamline without a sample point: topology templates and SEED_FARTHEST_POINT centres
+	std::vector<Singularity> critical_points;	// singularities the templates of the last run were placed around
+
+	// constructors
+
+	StreamlineEngine(const FieldSampler* field);
+
+	// methods
+
+	// places streamlines over the whole mesh, or over the region of params,
+	// replacing the previous result.
+	// The parts of the fixed streamlines that the new ones can get close to are
+	// copied in first; new streamlines keep their distance to them and are
+	// seeded next to them. A restricted run also seeds the gaps the queue
+	// does not reach, since a region may cut the mesh into separate parts.
+	void run(const PlacementParams& params, const StreamlineSet* fixed = NULL);
+
+	// lines of streamlines before this one were copied from fixed
+	int first_placed() const { return nfixed; }
+
+	// replaces the streamlines of the last run that pass through quads
+	// whose vectors were edited; update the FieldSampler first. The other
+	// streamlines and their grid entries are kept and only the space freed
+	// around the removed ones is seeded again. Meant for runs over the
+	// whole mesh. Returns the number of streamlines removed.
+	int update(const std::vector<int>& dirty_quads);
+
+	// listener is called from the thread that calls run
+	void set_listener(StreamlineListener listener, void* user);
+
+	// optional derivative cache of the field, or NULL: streamlines then
+	// end as soon as they enter a quad slower than min_speed all over, the
+	// cell walk reads its Jacobians and topology seeding its coefficients
+	// from it. Update it along with the FieldSampler.
+	void set_cache(const CellCache* cache_in) { cache = cache_in; }
+
+	// false if the last run was stopped or ran out of time before the
+	// queue was empty
+	bool complete() const { return completed; }
+
+	// drops the result of the last run; the buffers keep their capacity,
+	// so repeated runs of similar size do not allocate again
+	void reset();
+
+	// bytes held by the result and the working buffers
+	size_t memory_bytes() const;
+
+	// fraction of the mesh within 0.6 d_sep of a streamline, measured on
+	// a grid of probes d_sep/2 apart; gaps left between the streamlines
+	// lower it
+	double coverage() const;
+
+	// integration steps taken by the last run
+	long long nsteps() const { return steps; }
+
+	// candidate seeds the last run tested, and those that were too close to
+	// a streamline or off the mesh
+	long long ncandidates() const { return candidates; }
+	long long nrejected() const { return rejected; }
+	// streamlines traced and then put off by SEED_LONGEST_FIRST
+	int ndeferred() const { return deferrals; }
+
+	// half streamlines of the last run ended by each early stop
+	int loop_stops() const { return nloop_stops; }
+	int slow_stops() const { return nslow_stops; }
+	int stall_stops() const { return nstall_stops; }
+
+private:
+
+	const FieldSampler* field;
+	const CellIndex* index;
+	const CellCache* cache;
+
+	// quads across the y1, y2, x1 and x2 sides of every quad; -1 on the
+	// boundary, NO_EDGE if the side is not an edge of the mesh
+	std::vector<int> neighbors;
+	std::vector<icVector2> singularities;
+
+	std::queue<int> queue;		// streamlines whose neighbourhood has not been seeded yet
+	std::priority_queue<std::pair<int, int>> longest;	// the same for SEED_LONGEST_FIRST: (points, -line)
+	std::queue<icVector2> deferred;	// seeds of the short streamlines SEED_LONGEST_FIRST put off
+	std::vector<icVector2> forward_points, backward_points;	// scratch space of build_streamline
+	std::vector<icVector2> samples;		// scratch space of seed_from and insert_line
+	std::vector<int> batch_cells;		// scratch space of seed_from: the samples as FieldSampler::sample_batch takes them
+	std::vector<double> batch_x, batch_y, batch_vx, batch_vy;
+
+	// SEED_FARTHEST_POINT: triangulation of the streamline points and its
+	// triangles by circumradius, as (r^2, (triangle, serial))
+	Delaunay delaunay;
+	std::priority_queue<std::pair<double, std::pair<int, int>>> circles;
+	std::vector<int> created;
+	long long steps;
+	long long candidates, rejected;
+	int deferrals;
+	int nloop_stops, nslow_stops, nstall_stops;
+	double slow_speed;		// min_speed times the mean field magnitude
+	int nfixed;
+	int next_probe;			// next grid probe tried by seed_gap
+
+	StreamlineListener listener;
+	void* listener_user;
+	bool stop_requested;
+	bool completed;
+	std::chrono::steady_clock::time_point deadline;
+
+	// streamline points binned on a grid of d_sep sized cells, so the
+	// distance tests only visit nearby points
+	double grid_size;
+	int grid_nx, grid_ny;
+	std::vector<std::vector<int>> grid;
+
+	// points of the streamline being traced, on the same grid, with their
+	// arc length from the seed (negative on the backward half); only the
+	// bins listed in own_bins are in use
+	std::vector<std::vector<int>> own_grid;
+	std::vector<int> own_bins;
+	std::vector<icVector2> own_points;
+	std::vector<double> own_arc;
+	std::vector<double> point_arc;	// arc length from the seed of each point of the half being traced
+
+	void size_grid();
+	void add_to_grid(int first, int last);
+	void remap_grid(const std::vector<int>& remap);
+	void clear_own();
+	void add_own(const icVector2& point, double arc);
+	bool near_own(const icVector2& point, double arc, float min_d) const;
+
+	bool near_streamline(const icVector2& point, float min_d) const;
+	double sing_prox(const icVector2& pos) const;
+	bool direction(int cell, const icVector2& pos, icVector2& vect, double* speed = NULL) const;
+	int streamline_step(icVector2& cpos, icVector2& npos, int cquad, bool forward, double& speed) const;
+	int cell_step(const icVector2& cpos, icVector2& npos, int cquad, bool forward, double& speed) const;
+	void trace_half_streamline(icVector2 cpos, int cquad, bool forward, std::vector<icVector2>& points);
+	int build_streamline(double x, double y);
+	void drop_last_line();
+	double arc_length(int line) const;
+	void push_line(int line);
+	void clear_queues();
+	int next_deferred();
+	bool is_seed_point_valid(const icVector2& point, float min_d, double margin = 0) const;
+	bool should_stop() const;
+	void sample_line(int line, double spacing);
+	void seed_from(int line);
+	void copy_fixed(const StreamlineSet& fixed);
+	int seed_gap();
+	int next_line();
+	void load_singularities();
+	void measure_speed();
+	void place_from(int current);
+	void seed_topology();
+	void insert_line(int line);
+	int farthest_seed();
+	void place_farthest();
+};
@@ -0,0 +1,97 @@
+/*
+
+Multi-resolution streamline hierarchy
+
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include "streamlineHierarchy.h"
+
+void StreamlineHierarchy::clear()
+{
+	d_seps.clear();
+	level_end.clear();
+	lines.clear();
+}
+
+void StreamlineHierarchy::build(StreamlineEngine& engine, const PlacementParams& params, int nlevels)
+{
+	clear();
+	for (int i = 0; i < nlevels; i++)
+		add_level(engine, params);
+}
+
+int StreamlineHierarchy::add_level(StreamlineEngine& engine, const PlacementParams& base)
+{
+	PlacementParams params = base;
+	params.trace = false;
+	params.restrict_region = false;
+	if (!d_seps.empty())
+		params.d_sep = 0.5 * d_seps.back();
+
+	// a step longer than d_test could jump over the streamlines of the
+	// coarser levels; level 0 keeps the given step
+	params.step = std::min(params.step, params.d_test());
+
+	engine.run(params, nlevels() > 0 ? &lines : NULL);
+
+	const StreamlineSet& result = engine.streamlines;
+	for (int l = engine.first_placed(); l < result.nlines(); l++)
+		lines.add_line(result, l);
+	d_seps.push_back(params.d_sep);
+	level_end.push_back(lines.nlines());
+	return result.nlines() - engine.first_placed();
+}
+
+int StreamlineHierarchy::level_for(double d_sep) const
+{
+	int level = 0;
+	for (int k = 1; k < nlevels(); k++)
+		if (d_seps[k] >= d_sep * (1 - 1e-9))
+			level = k;
+	return level;
+}
+
+bool StreamlineHierarchy::write(const char* filename) const
+{
+	FILE* fp = fopen(filename, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Can't open %s for writing\n", filename);
+		return false;
+	}
+	fprintf(fp, "%d\n", nlevels());
+	for (int k = 0; k < nlevels(); k++)
+		fprintf(fp, "%.17g %d\n", d_seps[k], level_end[k]);
+	bool ok = lines.write(fp);
+	fclose(fp);
+	return ok;
+}
+
+bool StreamlineHierarchy::read(const char* filename)
+{
+	clear();
+	FILE* fp = fopen(filename, "r");
+	if (fp == NULL) {
+		fprintf(stderr, "Can't open %s\n", filename);
+		return false;
+	}
+
+	int n = 0;
+	bool ok = fscanf(fp, "%d", &n) == 1 && n >= 0;
+	for (int k = 0; ok && k < n; k++) {
+		double d_sep;
+		int end;
+		ok = fscanf(fp, "%lf %d", &d_sep, &end) == 2 && end >= (k > 0 ? level_end.back() : 0);
+		d_seps.push_back(d_sep);
+		level_end.push_back(end);
+	}
+	ok = ok && lines.read(fp) && (n == 0 || level_end.back() == lines.nlines());
+	fclose(fp);
+
+	if (!ok) {
+		fprintf(stderr, "%s is not a streamline hierarchy\n", filename);
+		clear();
+	}
+	return ok;
+}
@@ -0,0 +1,48 @@
+/*
+
+Multi-resolution streamline hierarchy (Jobard and Lefer 1997, section 5)
+
+Level 0 is placed at d_sep, level k at d_sep / 2^k. Every finer level is
+placed with the coarser streamlines as fixed lines, so it keeps them and
+only adds new ones in between. The levels are therefore nested and the
+streamlines are stored once, coarsest level first: level k is the first
+level_end[k] lines of lines. A viewer switches density by drawing a
+different prefix, without placing again.
+
+*/
+
+#pragma once
+#include <vector>
+#include "streamlineEngine.h"
+
+class StreamlineHierarchy
+{
+public:
+
+	// fields
+	std::vector<double> d_seps;		// separating distance of each level, coarsest first
+	std::vector<int> level_end;		// lines of level k are lines 0 .. level_end[k]-1
+	StreamlineSet lines;
+
+	// methods
+
+	void clear();
+	int nlevels() const { return (int)d_seps.size(); }
+	int level_lines(int level) const { return level_end[level]; }
+
+	// places nlevels levels starting at params.d_sep
+	void build(StreamlineEngine& engine, const PlacementParams& params, int nlevels);
+
+	// adds a level at half the d_sep of the finest one (params.d_sep if the
+	// hierarchy is empty); the other parameters are taken from params.
+	// Returns the number of streamlines added.
+	int add_level(StreamlineEngine& engine, const PlacementParams& params);
+
+	// finest level whose streamlines are at least d_sep apart, 0 if none is
+	int level_for(double d_sep) const;
+
+	// writes the level count, one "d_sep lines" row per level, then the
+	// lines in the format of StreamlineSet::write
+	bool write(const char* filename) const;
+	bool read(const char* filename);
+};
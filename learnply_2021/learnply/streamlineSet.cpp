@@ -0,0 +1,145 @@
+/*
+
+Packed storage for a set of streamlines
+
+*/
+
+#include <stdio.h>
+#include "streamlineSet.h"
+
+StreamlineSet::StreamlineSet(int nattribs_in)
+{
+	nattribs = nattribs_in;
+	offsets.push_back(0);
+}
+
+// keeps the capacity of the buffers for the next run
+void StreamlineSet::clear()
+{
+	xy.clear();
+	offsets.clear();
+	offsets.push_back(0);
+	seeds.clear();
+	attribs.clear();
+}
+
+void StreamlineSet::add_point(double x, double y, const float* attrib)
+{
+	xy.push_back(x);
+	xy.push_back(y);
+	for (int i = 0; i < nattribs; i++)
+		attribs.push_back(attrib == NULL ? 0.0f : attrib[i]);
+}
+
+int StreamlineSet::end_line(int seed)
+{
+	offsets.push_back(npoints());
+	seeds.push_back(seed);
+	return nlines() - 1;
+}
+
+int StreamlineSet::add_line(const std::vector<icVector2>& pts, int seed)
+{
+	for (int i = 0; i < pts.size(); i++)
+		add_point(pts[i].x, pts[i].y);
+	return end_line(seed);
+}
+
+int StreamlineSet::add_line(const StreamlineSet& from, int line)
+{
+	for (int k = from.line_begin(line); k < from.line_end(line); k++)
+		add_point(from.xy[2 * k], from.xy[2 * k + 1], nattribs > 0 && from.nattribs == nattribs ? from.attrib(k) : NULL);
+	return end_line(from.seeds[line]);
+}
+
+void StreamlineSet::pop_line()
+{
+	offsets.pop_back();
+	seeds.pop_back();
+	xy.resize(2 * offsets.back());
+	attribs.resize(nattribs * offsets.back());
+}
+
+void StreamlineSet::remove_lines(const std::vector<char>& remove, std::vector<int>& remap)
+{
+	remap.assign(npoints(), -1);
+	int np = 0, nl = 0;
+	for (int i = 0; i < nlines(); i++) {
+		if (remove[i])
+			continue;
+		for (int k = line_begin(i); k < line_end(i); k++) {
+			remap[k] = np;
+			xy[2 * np] = xy[2 * k];
+			xy[2 * np + 1] = xy[2 * k + 1];
+			for (int a = 0; a < nattribs; a++)
+				attribs[nattribs * np + a] = attribs[nattribs * k + a];
+			np++;
+		}
+		seeds[nl] = seeds[i];
+		offsets[++nl] = np;
+	}
+	xy.resize(2 * np);
+	attribs.resize(nattribs * np);
+	offsets.resize(nl + 1);
+	seeds.resize(nl);
+}
+
+PolyLine StreamlineSet::polyline(int line) const
+{
+	PolyLine pl;
+	for (int k = line_begin(line) + 1; k < line_end(line); k++) {
+		icVector2 a = point(k - 1), b = point(k);
+		pl.push_back(LineSegment(a.x, a.y, 0, b.x, b.y, 0));
+	}
+	return pl;
+}
+
+bool StreamlineSet::write(const char* filename) const
+{
+	FILE* fp = fopen(filename, "w");
+	if (fp == NULL) {
+		fprintf(stderr, "Can't open %s for writing\n", filename);
+		return false;
+	}
+	bool ok = write(fp);
+	fclose(fp);
+	return ok;
+}
+
+bool StreamlineSet::write(FILE* fp) const
+{
+	fprintf(fp, "%d\n", nlines());
+	for (int i = 0; i < nlines(); i++) {
+		fprintf(fp, "%d\n", line_size(i));
+		for (int k = line_begin(i); k < line_end(i); k++)
+			fprintf(fp, "%.9g %.9g\n", xy[2 * k], xy[2 * k + 1]);
+	}
+	return !ferror(fp);
+}
+
+bool StreamlineSet::read(FILE* fp)
+{
+	clear();
+	int n = 0;
+	if (fscanf(fp, "%d", &n) != 1 || n < 0)
+		return false;
+	for (int i = 0; i < n; i++) {
+		int size = 0;
+		if (fscanf(fp, "%d", &size) != 1 || size < 0)
+			return false;
+		for (int k = 0; k < size; k++) {
+			double x, y;
+			if (fscanf(fp, "%lf %lf", &x, &y) != 2)
+				return false;
+			add_point(x, y);
+		}
+		end_line();
+	}
+	return true;
+}
+
+size_t StreamlineSet::memory_bytes() const
+{
+	return xy.capacity() * sizeof(double) + offsets.capacity() * sizeof(int) +
+		seeds.capacity() * sizeof(int) + attribs.capacity() * sizeof(float);
+}
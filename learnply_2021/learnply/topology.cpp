@@ -0,0 +1,164 @@
+/*
+
+Singularities of the vertex vector field and their classification
+
+*/
+
+#include <math.h>
+#include "topology.h"
+
+// a zero on the side between two quads belongs to the quad on its right or top
+static const double EDGE_EPS = 1e-9;
+
+// |real part| / imaginary part of the eigenvalues below which a focus is a centre
+static const double CENTER_RATIO = 1e-3;
+
+const char* singularity_name(SingularityType type)
+{
+	switch (type) {
+	case SING_SOURCE: return "source";
+	case SING_SINK: return "sink";
+	case SING_SADDLE: return "saddle";
+	case SING_CENTER: return "centre";
+	case SING_REPELLING_FOCUS: return "repelling focus";
+	case SING_ATTRACTING_FOCUS: return "attracting focus";
+	}
+	return "unknown";
+}
+
+// unit vector in the null space of J - lambda I
+static icVector2 eigenvector(const double j[2][2], double lambda)
+{
+	icVector2 u(j[0][1], lambda - j[0][0]);
+	icVector2 v(lambda - j[1][1], j[1][0]);
+	icVector2 e = length(u) >= length(v) ? u : v;
+	if (length(e) < 1e-12 * (fabs(j[0][0]) + fabs(j[0][1]) + fabs(j[1][0]) + fabs(j[1][1]) + 1e-300))
+		return icVector2(1, 0);		// J is a multiple of I, every direction is an eigenvector
+	normalize(e);
+	return e;
+}
+
+void classify_singularity(Singularity& sing)
+{
+	const double (*j)[2] = sing.jacobian;
+	double trace = j[0][0] + j[1][1];
+	double det = j[0][0] * j[1][1] - j[0][1] * j[1][0];
+	double disc = trace * trace - 4 * det;
+
+	if (disc < 0) {
+		double re = 0.5 * trace, im = 0.5 * sqrt(-disc);
+		sing.eigval[0] = re;
+		sing.eigval[1] = im;
+		if (fabs(re) <= CENTER_RATIO * im)
+			sing.type = SING_CENTER;
+		else
+			sing.type = re > 0 ? SING_REPELLING_FOCUS : SING_ATTRACTING_FOCUS;
+		sing.eigvec[0] = sing.eigvec[1] = icVector2(0, 0);
+		return;
+	}
+
+	double root = sqrt(disc);
+	sing.eigval[0] = 0.5 * (trace + root);
+	sing.eigval[1] = 0.5 * (trace - root);
+	if (det < 0)
+		sing.type = SING_SADDLE;
+	else
+		sing.type = trace > 0 ? SING_SOURCE : SING_SINK;
+	sing.eigvec[0] = eigenvector(j, sing.eigval[0]);
+	sing.eigvec[1] = eigenvector(j, sing.eigval[1]);
+	if (root == 0)
+		sing.eigvec[1] = icVector2(-sing.eigvec[0].y, sing.eigvec[0].x);
+}
+
+void extract_singularities(const FieldSampler& field, std::vector<Singularity>& sings, const CellCache* cache)
+{
+	sings.clear();
+	extract_singularities(field, 0, (int)field.f11.size(), sings, cache);
+}
+
+void extract_singularities(const FieldSampler& field, int first, int last, std::vector<Singularity>& sings,
+	const CellCache* cache)
+{
+	const CellIndex& index = *field.index;
+	for (int i = first; i < last; i++)
+	{
+		double x1 = index.qx1[i], x2 = index.qx2[i];
+		double y1 = index.qy1[i], y2 = index.qy2[i];
+
+		// f(s,t) = a00 + a10 s + a01 t + a11 s t, g likewise, with s and t
+		// going from 0 to 1 across the quad
+		double a00, a10, a01, a11, b00, b10, b01, b11;
+		if (cache != NULL) {
+			a00 = cache->a00[i]; a10 = cache->a10[i]; a01 = cache->a01[i]; a11 = cache->a11[i];
+			b00 = cache->b00[i]; b10 = cache->b10[i]; b01 = cache->b01[i]; b11 = cache->b11[i];
+			// zeros are accepted up to EDGE_EPS outside the quad, where the
+			// magnitude is lower than inside by at most EDGE_EPS times the slopes
+			double slope = fabs(a10) + fabs(a01) + fabs(b10) + fabs(b01) + 2 * (fabs(a11) + fabs(b11));
+			if (cache->min_speed[i] > 2 * EDGE_EPS * slope)
+				continue;
+		}
+		else {
+			a00 = field.f11[i];
+			a10 = field.f21[i] - field.f11[i];
+			a01 = field.f12[i] - field.f11[i];
+			a11 = field.f11[i] - field.f21[i] - field.f12[i] + field.f22[i];
+			b00 = field.g11[i];
+			b10 = field.g21[i] - field.g11[i];
+			b01 = field.g12[i] - field.g11[i];
+			b11 = field.g11[i] - field.g21[i] - field.g12[i] + field.g22[i];
+		}
+
+		// eliminating t from f = 0 and g = 0 leaves A s^2 + B s + C = 0
+		double A = b10 * a11 - b11 * a10;
+		double B = b00 * a11 + b10 * a01 - b01 * a10 - b11 * a00;
+		double C = b00 * a01 - b01 * a00;
+		double scale = fabs(A) + fabs(B) + fabs(C);
+		if (scale == 0)
+			continue;		// f and g are parallel over the whole quad
+
+		double s_roots[2];
+		int nroots = 0;
+		if (fabs(A) < 1e-12 * scale) {
+			if (fabs(B) >= 1e-12 * scale)
+				s_roots[nroots++] = -C / B;
+		}
+		else {
+			double disc = B * B - 4 * A * C;
+			if (disc >= 0) {
+				// the numerically stable form of the quadratic formula
+				double q = -0.5 * (B + (B >= 0 ? sqrt(disc) : -sqrt(disc)));
+				s_roots[nroots++] = q / A;
+				if (q != 0 && disc > 0)
+					s_roots[nroots++] = C / q;
+			}
+		}
+
+		for (int k = 0; k < nroots; k++) {
+			double s = s_roots[k];
+			if (s < -EDGE_EPS || s >= 1 - EDGE_EPS)
+				continue;
+			// t from whichever of f and g depends on it more strongly
+			double fden = a01 + a11 * s, gden = b01 + b11 * s;
+			double t;
+			if (fabs(fden) >= fabs(gden)) {
+				if (fden == 0)
+					continue;
+				t = -(a00 + a10 * s) / fden;
+			}
+			else
+				t = -(b00 + b10 * s) / gden;
+			if (t < -EDGE_EPS || t >= 1 - EDGE_EPS)
+				continue;
+
+			Singularity sing;
+			sing.pos.set(x1 + s * (x2 - x1), y1 + t * (y2 - y1));
+			sing.quad = i;
+			sing.jacobian[0][0] = (a10 + a11 * t) / (x2 - x1);
+			sing.jacobian[0][1] = (a01 + a11 * s) / (y2 - y1);
+			sing.jacobian[1][0] = (b10 + b11 * t) / (x2 - x1);
+			sing.jacobian[1][1] = (b01 + b11 * s) / (y2 - y1);
+			classify_singularity(sing);
+			sings.push_back(sing);
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/*
+
+Singularities of the vertex vector field and their classification
+
+Every quad is searched for zeros of its bilinear interpolant, and each
+zero is classified from the eigenvalues of the Jacobian there. The
+corner vectors and bounds come from a FieldSampler and its CellIndex,
+so no vertex lookups are done.
+
+*/
+
+#pragma once
+#include <vector>
+#include "fieldSampler.h"
+#include "cellCache.h"
+
+enum SingularityType
+{
+	SING_SOURCE,			// two positive real eigenvalues
+	SING_SINK,				// two negative real eigenvalues
+	SING_SADDLE,			// real eigenvalues of opposite sign
+	SING_CENTER,			// imaginary eigenvalues
+	SING_REPELLING_FOCUS,	// complex eigenvalues, positive real part
+	SING_ATTRACTING_FOCUS	// complex eigenvalues, negative real part
+};
+
+struct Singularity
+{
+	icVector2 pos;
+	int quad;					// index into poly->qlist
+	double jacobian[2][2];		// {{df/dx, df/dy}, {dg/dx, dg/dy}}
+	SingularityType type;
+	// real eigenvalues and unit eigenvectors, largest eigenvalue first;
+	// for complex eigenvalues eigval holds the real and imaginary part and
+	// the eigenvectors are not set
+	double eigval[2];
+	icVector2 eigvec[2];
+};
+
+// name of a singularity type, for reports
+const char* singularity_name(SingularityType type);
+
+// classifies a singularity from its Jacobian and sets type, eigval and eigvec
+void classify_singularity(Singularity& sing);
+
+// finds and classifies the singularities of every quad, in quad order.
+// A zero on a side shared by two quads is reported by one of them only.
+// With a cache, the quads whose magnitude bound rules out a zero are
+// skipped and the others read their coefficients from it.
+void extract_singularities(const FieldSampler& field, std::vector<Singularity>& sings, const CellCache* cache = NULL);
+
+// same for quads [first,last) only, appending to sings
+void extract_singularities(const FieldSampler& field, int first, int last, std::vector<Singularity>& sings,
+	const CellCache* cache = NULL);
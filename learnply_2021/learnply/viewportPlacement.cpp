@@ -0,0 +1,88 @@
+/*
+
+Streamline placement restricted to the visible part of the mesh
+
+*/
+
+#include <math.h>
+#include "viewportPlacement.h"
+
+ViewportPlacement::ViewportPlacement(const FieldSampler* field, double tile_size_in) : engine(field)
+{
+	index = field->index;
+	tile_size = tile_size_in;
+	tile = tile_size * cached.d_sep;
+}
+
+// places tile (i,j); its streamlines may run one tile beyond it, so the
+// cached tiles up to two tiles away can reach into that area
+void ViewportPlacement::place_tile(int i, int j)
+{
+	fixed.clear();
+	for (int dj = -2; dj <= 2; dj++)
+		for (int di = -2; di <= 2; di++) {
+			std::map<std::pair<int, int>, StreamlineSet>::const_iterator it = tiles.find(std::make_pair(i + di, j + dj));
+			if (it == tiles.end())
+				continue;
+			const StreamlineSet& set = it->second;
+			for (int l = 0; l < set.nlines(); l++)
+				fixed.add_line(set, l);
+		}
+
+	PlacementParams params = cached;
+	params.trace = false;
+	params.time_budget = 0;
+	params.restrict_region = true;
+	params.region_x1 = index->xmin + i * tile;
+	params.region_y1 = index->ymin + j * tile;
+	params.region_x2 = params.region_x1 + tile;
+	params.region_y2 = params.region_y1 + tile;
+	params.region_margin = tile;
+	params.seed_x = 0.5 * (params.region_x1 + params.region_x2);
+	params.seed_y = 0.5 * (params.region_y1 + params.region_y2);
+	engine.run(params, &fixed);
+
+	// keep only the streamlines placed for this tile
+	const StreamlineSet& result = engine.streamlines;
+	StreamlineSet& set = tiles[std::make_pair(i, j)];
+	set.clear();
+	for (int l = engine.first_placed(); l < result.nlines(); l++)
+		set.add_line(result, l);
+}
+
+int ViewportPlacement::place(const PlacementParams& params, const double rect[4], StreamlineSet& lines)
+{
+	if (!params.same_placement(cached)) {
+		tiles.clear();
+		cached = params;
+		tile = tile_size * params.d_sep;
+	}
+
+	// tiles overlapping both the rectangle and the mesh
+	double x1 = fmax(rect[0], index->xmin), x2 = fmin(rect[2], index->xmax);
+	double y1 = fmax(rect[1], index->ymin), y2 = fmin(rect[3], index->ymax);
+	lines.clear();
+	if (x1 > x2 || y1 > y2)
+		return 0;
+	int i1 = (int)floor((x1 - index->xmin) / tile), i2 = (int)floor((x2 - index->xmin) / tile);
+	int j1 = (int)floor((y1 - index->ymin) / tile), j2 = (int)floor((y2 - index->ymin) / tile);
+
+	int nplaced = 0;
+	for (int j = j1; j <= j2; j++)
+		for (int i = i1; i <= i2; i++)
+			if (tiles.find(std::make_pair(i, j)) == tiles.end()) {
+				place_tile(i, j);
+				nplaced++;
+			}
+
+	// streamlines seeded in a cached tile next to the view may run into it
+	for (int j = j1 - 1; j <= j2 + 1; j++)
+		for (int i = i1 - 1; i <= i2 + 1; i++) {
+			std::map<std::pair<int, int>, StreamlineSet>::const_iterator it = tiles.find(std::make_pair(i, j));
+			if (it == tiles.end())
+				continue;
+			for (int l = 0; l < it->second.nlines(); l++)
+				lines.add_line(it->second, l);
+		}
+	return nplaced;
+}
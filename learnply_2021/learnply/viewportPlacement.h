@@ -0,0 +1,50 @@
+/*
+
+Streamline placement restricted to the visible part of the mesh
+
+The mesh plane is cut into square tiles. Streamlines are seeded one tile
+at a time and kept in a cache, so a view only costs the tiles that have
+not been seen before. A streamline may run up to one tile beyond the
+tile it was seeded in, so most lines cross tile borders without a break.
+A new tile takes the cached streamlines that reach near it as fixed
+streamlines: new lines keep their distance to them and are seeded next
+to them, so no doubled lines appear along the tile borders.
+
+*/
+
+#pragma once
+#include <map>
+#include <utility>
+#include "streamlineEngine.h"
+
+class ViewportPlacement
+{
+public:
+
+	// constructors
+
+	// tiles are tile_size * d_sep wide
+	ViewportPlacement(const FieldSampler* field, double tile_size = 10);
+
+	// methods
+
+	// streamlines of every tile overlapping rect {xmin, ymin, xmax, ymax},
+	// placing missing tiles first; returns the number of tiles placed.
+	// The cache is dropped when a parameter that changes the placement does.
+	int place(const PlacementParams& params, const double rect[4], StreamlineSet& lines);
+
+	void clear() { tiles.clear(); }
+	int ncached() const { return (int)tiles.size(); }
+
+private:
+
+	const CellIndex* index;
+	StreamlineEngine engine;
+	double tile_size;
+	double tile;					// tile width in mesh units
+	PlacementParams cached;			// parameters the tiles were placed with
+	std::map<std::pair<int, int>, StreamlineSet> tiles;
+	StreamlineSet fixed;			// scratch: neighbours of the tile being placed
+
+	void place_tile(int i, int j);
+};